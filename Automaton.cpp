@@ -0,0 +1,415 @@
+#include "Automaton.h"
+
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <stdexcept>
+#include <string>
+
+namespace ahocorasick {
+
+// Las tablas se vuelcan y se proyectan tal cual desde las instantáneas.
+static_assert(sizeof(Automaton::Output) == 2 * sizeof(uint32_t),
+              "Automaton::Output no debe tener relleno");
+
+int char_to_index(char c) {
+    if (c == ' ') return 26;
+    if (c == '-') return 27;
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= 'A' && c <= 'Z') return std::tolower(c) - 'a';
+    return -1;
+}
+
+std::array<uint8_t, 256> Automaton::letter_classes() {
+    std::array<uint8_t, 256> classes;
+    for (int c = 0; c < 256; ++c) {
+        const int idx = char_to_index(static_cast<char>(c));
+        classes[c] = idx < 0 ? kNoClass : static_cast<uint8_t>(idx);
+    }
+    return classes;
+}
+
+bool Automaton::add_classes(const PatternPool& normalized, PatternID first) {
+    const uint32_t old_stride = stride;
+    for (PatternID i = first; i < normalized.size(); ++i) {
+        for (unsigned char c : normalized[i]) {
+            if (byte_class[c] != 0) continue;
+            // Como mucho 256 - 26 clases más la 0: nunca llega a kNoClass.
+            const auto cls = static_cast<uint8_t>(stride++);
+            byte_class[std::tolower(c)] = cls;
+            byte_class[std::toupper(c)] = cls;
+        }
+    }
+    if (stride == old_stride) return false;
+    // Las columnas nuevas van al final de cada fila y empiezan vacías.
+    std::vector<StateID>& next = transitions.mutable_data();
+    const size_t states = next.size() / old_stride;
+    next.resize(states * stride, kRootState);
+    for (size_t state = states; state-- > 0;) {
+        std::copy_backward(next.begin() + state * old_stride,
+                           next.begin() + (state + 1) * old_stride,
+                           next.begin() + state * stride + old_stride);
+        std::fill(next.begin() + state * stride + old_stride,
+                  next.begin() + (state + 1) * stride, kRootState);
+    }
+    return true;
+}
+
+void Automaton::build(const PatternPool& normalized, std::vector<PatternID>& canonical) {
+    if (normalized.size() >= kNoOutput) {
+        throw std::invalid_argument("Demasiados patrones para el autómata");
+    }
+    // Las tablas se descartan sin copiar aunque sean vistas de una instantánea.
+    transitions.reset();
+    fail.reset();
+    output_link.reset();
+    depth.reset();
+    out_head.reset();
+    outputs.reset();
+    storage.reset();
+    std::vector<StateID>& next = transitions.mutable_data();
+    std::vector<uint32_t>& depths = depth.mutable_data();
+    std::vector<uint32_t>& heads = out_head.mutable_data();
+    std::vector<Output>& outs = outputs.mutable_data();
+    if (alphabet == Alphabet::Letters) {
+        byte_class = letter_classes();
+        stride = ALPHABET_SIZE;
+    } else {
+        byte_class.fill(0);
+        stride = 1;
+        add_classes(normalized, 0);
+    }
+    next.assign(stride, kRootState);
+    depths.assign(1, 0);
+    heads.assign(1, kNoOutput);
+    max_depth = 0;
+    fail_first_child.clear();
+    fail_next_sibling.clear();
+    fail_prev_sibling.clear();
+
+    canonical.resize(normalized.size());
+    for (PatternID i = 0; i < normalized.size(); ++i) {
+        canonical[i] = i;
+        std::string_view pattern = normalized[i];
+        if (pattern.empty()) continue;
+
+        StateID state = kRootState;
+        for (char c : pattern) {
+            const size_t slot = state * stride + byte_class[static_cast<unsigned char>(c)];
+            if (next[slot] == kRootState) {
+                if (depths.size() >= UINT32_MAX) {
+                    throw std::length_error("El autómata supera el número máximo de estados");
+                }
+                next[slot] = static_cast<StateID>(depths.size());
+                depths.push_back(depths[state] + 1);
+                heads.push_back(kNoOutput);
+                next.resize(next.size() + stride, kRootState);
+                max_depth = std::max(max_depth, depths.back());
+            }
+            state = next[slot];
+        }
+        if (heads[state] != kNoOutput) {
+            // Misma cadena normalizada que un patrón anterior: solo se
+            // emite el primero.
+            canonical[i] = outs[heads[state]].pattern;
+            continue;
+        }
+        heads[state] = static_cast<uint32_t>(outs.size());
+        outs.push_back({static_cast<uint32_t>(i), kNoOutput});
+    }
+
+    const size_t states = depths.size();
+    std::vector<StateID>& fails = fail.mutable_data();
+    std::vector<StateID>& links = output_link.mutable_data();
+    fails.assign(states, kRootState);
+    links.assign(states, kRootState);
+
+    std::queue<StateID> pending;
+    for (uint32_t c = 0; c < stride; ++c) {
+        if (next[c] != kRootState) pending.push(next[c]);
+    }
+    while (!pending.empty()) {
+        const StateID state = pending.front();
+        pending.pop();
+        for (uint32_t c = 0; c < stride; ++c) {
+            const StateID child = next[state * stride + c];
+            if (child == kRootState) continue;
+            pending.push(child);
+            StateID failure = fails[state];
+            while (failure != kRootState && next[failure * stride + c] == kRootState) {
+                failure = fails[failure];
+            }
+            fails[child] = next[failure * stride + c];
+            links[child] = heads[fails[child]] == kNoOutput ? links[fails[child]] : fails[child];
+        }
+    }
+}
+
+namespace {
+
+// Operaciones sobre el árbol de fallos inverso de un Automaton.
+class FailTree {
+public:
+    explicit FailTree(Automaton& automaton)
+        : fail_(automaton.fail.mutable_data()),
+          first_child_(automaton.fail_first_child),
+          next_(automaton.fail_next_sibling),
+          prev_(automaton.fail_prev_sibling) {
+        if (first_child_.size() == fail_.size()) return;
+        first_child_.assign(fail_.size(), kRootState);
+        next_.assign(fail_.size(), kRootState);
+        prev_.assign(fail_.size(), kRootState);
+        for (StateID state = static_cast<StateID>(fail_.size()) - 1; state > kRootState; --state) {
+            attach(state);
+        }
+    }
+
+    void add_state() {
+        first_child_.push_back(kRootState);
+        next_.push_back(kRootState);
+        prev_.push_back(kRootState);
+    }
+    // Cuelga state de su enlace de fallo actual.
+    void attach(StateID state) {
+        const StateID parent = fail_[state];
+        next_[state] = first_child_[parent];
+        prev_[state] = kRootState;
+        if (first_child_[parent] != kRootState) prev_[first_child_[parent]] = state;
+        first_child_[parent] = state;
+    }
+    void relink(StateID state, StateID new_fail) {
+        if (prev_[state] != kRootState) {
+            next_[prev_[state]] = next_[state];
+        } else {
+            first_child_[fail_[state]] = next_[state];
+        }
+        if (next_[state] != kRootState) prev_[next_[state]] = prev_[state];
+        fail_[state] = new_fail;
+        attach(state);
+    }
+    template <typename Visit>
+    void for_each_child(StateID state, Visit visit) const {
+        for (StateID child = first_child_[state]; child != kRootState; child = next_[child]) {
+            visit(child);
+        }
+    }
+
+private:
+    std::vector<StateID>& fail_;
+    std::vector<StateID>& first_child_;
+    std::vector<StateID>& next_;
+    std::vector<StateID>& prev_;
+};
+
+} // namespace
+
+void Automaton::insert(const PatternPool& normalized, PatternID first,
+                       std::vector<PatternID>& canonical) {
+    if (normalized.size() >= kNoOutput) {
+        throw std::invalid_argument("Demasiados patrones para el autómata");
+    }
+    FailTree tree(*this);
+    if (alphabet == Alphabet::Bytes) add_classes(normalized, first);
+    std::vector<StateID>& next = transitions.mutable_data();
+    std::vector<StateID>& links = output_link.mutable_data();
+    std::vector<uint32_t>& depths = depth.mutable_data();
+    std::vector<uint32_t>& heads = out_head.mutable_data();
+    std::vector<Output>& outs = outputs.mutable_data();
+    std::vector<StateID>& fails = fail.mutable_data();
+    storage.reset();
+
+    const StateID first_new = static_cast<StateID>(depths.size());
+    // Estados nuevos con su padre y el carácter que lleva a ellos.
+    struct Created {
+        StateID state;
+        StateID parent;
+        int c;
+    };
+    std::vector<Created> created;
+    // Estados cuya lista de enlaces de salida hay que recalcular.
+    std::vector<StateID> dirty;
+
+    canonical.resize(normalized.size());
+    for (PatternID i = first; i < normalized.size(); ++i) {
+        canonical[i] = i;
+        std::string_view pattern = normalized[i];
+        if (pattern.empty()) continue;
+
+        StateID state = kRootState;
+        for (char c : pattern) {
+            const int idx = byte_class[static_cast<unsigned char>(c)];
+            const size_t slot = state * stride + idx;
+            if (next[slot] == kRootState) {
+                if (depths.size() >= UINT32_MAX) {
+                    throw std::length_error("El autómata supera el número máximo de estados");
+                }
+                const StateID child = static_cast<StateID>(depths.size());
+                next[slot] = child;
+                depths.push_back(depths[state] + 1);
+                heads.push_back(kNoOutput);
+                fails.push_back(kRootState);
+                links.push_back(kRootState);
+                tree.add_state();
+                next.resize(next.size() + stride, kRootState);
+                max_depth = std::max(max_depth, depths.back());
+                created.push_back({child, state, idx});
+            }
+            state = next[slot];
+        }
+        if (heads[state] != kNoOutput) {
+            canonical[i] = outs[heads[state]].pattern;
+            continue;
+        }
+        heads[state] = static_cast<uint32_t>(outs.size());
+        outs.push_back({static_cast<uint32_t>(i), kNoOutput});
+        // Un estado que empieza a tener salidas cambia el enlace de salida
+        // de todo su subárbol de fallos.
+        if (state < first_new) dirty.push_back(state);
+    }
+
+    // Por profundidad creciente, así el enlace de fallo del padre (y de
+    // cualquier sufijo más corto) ya es definitivo.
+    std::stable_sort(created.begin(), created.end(), [&](const Created& a, const Created& b) {
+        return depths[a.state] < depths[b.state];
+    });
+    std::vector<StateID> stack;
+    for (const Created& node : created) {
+        StateID failure = kRootState;
+        if (node.parent != kRootState) {
+            failure = fails[node.parent];
+            while (failure != kRootState && next[failure * stride + node.c] == kRootState) {
+                failure = fails[failure];
+            }
+            failure = next[failure * stride + node.c];
+        }
+        fails[node.state] = failure;
+        tree.attach(node.state);
+        dirty.push_back(node.state);
+
+        // Los estados existentes que terminan en la cadena del nuevo son
+        // hijos por node.c de los sufijos del padre (su subárbol de fallos).
+        // Una rama se poda en cuanto un estado tiene ya ese hijo: sus
+        // descendientes encuentran antes un sufijo más largo.
+        stack.clear();
+        tree.for_each_child(node.parent, [&](StateID child) { stack.push_back(child); });
+        while (!stack.empty()) {
+            const StateID suffix_of = stack.back();
+            stack.pop_back();
+            const StateID target = next[suffix_of * stride + node.c];
+            if (target == kRootState) {
+                tree.for_each_child(suffix_of, [&](StateID child) { stack.push_back(child); });
+            } else if (target < first_new) {
+                tree.relink(target, node.state);
+                dirty.push_back(target);
+            }
+        }
+    }
+
+    // Recalcula los enlaces de salida de arriba abajo en los subárboles
+    // afectados; las raíces más someras primero para no repetir trabajo.
+    std::sort(dirty.begin(), dirty.end(), [&](StateID a, StateID b) {
+        return depths[a] < depths[b];
+    });
+    std::vector<bool> visited(depths.size(), false);
+    for (StateID root : dirty) {
+        if (visited[root]) continue;
+        stack.assign(1, root);
+        while (!stack.empty()) {
+            const StateID state = stack.back();
+            stack.pop_back();
+            visited[state] = true;
+            const StateID failure = fails[state];
+            links[state] = heads[failure] == kNoOutput ? links[failure] : failure;
+            tree.for_each_child(state, [&](StateID child) { stack.push_back(child); });
+        }
+    }
+}
+
+void Automaton::validate(size_t pattern_count) const {
+    auto corrupt = [](const std::string& what) {
+        return std::runtime_error("Instantánea del autómata corrupta: " + what);
+    };
+    const size_t states = state_count();
+    if (alphabet == Alphabet::Letters ? stride != ALPHABET_SIZE || byte_class != letter_classes()
+                                      : stride == 0 || stride > kNoClass) {
+        throw corrupt("alfabeto inválido");
+    }
+    if (alphabet == Alphabet::Bytes) {
+        for (uint8_t cls : byte_class) {
+            if (cls >= stride) throw corrupt("clase de byte fuera de rango");
+        }
+    }
+    if (states == 0 || transitions.size() != states * stride ||
+        output_link.size() != states || depth.size() != states || out_head.size() != states) {
+        throw corrupt("tamaños de tabla incoherentes");
+    }
+    if (depth[kRootState] != 0 || fail[kRootState] != kRootState ||
+        output_link[kRootState] != kRootState || out_head[kRootState] != kNoOutput) {
+        throw corrupt("estado raíz inválido");
+    }
+    for (size_t state = 0; state < states; ++state) {
+        if (depth[state] > max_depth) throw corrupt("profundidad fuera de rango");
+        for (uint32_t c = 0; c < stride; ++c) {
+            const StateID child = transitions[state * stride + c];
+            if (child != kRootState && (child >= states || depth[child] != depth[state] + 1)) {
+                throw corrupt("transición inválida");
+            }
+        }
+        if (state == kRootState) continue;
+        // Los enlaces siempre apuntan a estados menos profundos, así que
+        // ninguna cadena de fallos o de salidas puede formar un ciclo.
+        if (fail[state] >= states || depth[fail[state]] >= depth[state]) {
+            throw corrupt("enlace de fallo inválido");
+        }
+        if (output_link[state] >= states || depth[output_link[state]] >= depth[state]) {
+            throw corrupt("enlace de salida inválido");
+        }
+        if (out_head[state] != kNoOutput && out_head[state] >= outputs.size()) {
+            throw corrupt("lista de salidas inválida");
+        }
+    }
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        if (outputs[i].pattern >= pattern_count) throw corrupt("patrón fuera de rango");
+        const uint32_t next = outputs[i].next;
+        if (next != kNoOutput && (next <= i || next >= outputs.size())) {
+            throw corrupt("lista de salidas inválida");
+        }
+    }
+}
+
+TransitionCache::TransitionCache(const Automaton& automaton, size_t max_rows)
+    : automaton_(automaton), stride_(automaton.stride) {
+    const size_t limit = std::max<size_t>(1, std::min(max_rows, automaton.state_count()));
+    size_t capacity = 1;
+    while (capacity < limit) capacity <<= 1;
+    mask_ = capacity - 1;
+    tags_.assign(capacity, kEmptySlot);
+    rows_.resize(capacity * stride_);
+}
+
+void TransitionCache::fill(size_t slot, StateID state) {
+    ++misses_;
+    StateID* row = &rows_[slot * stride_];
+    const StateID* children = &automaton_.transitions[state * stride_];
+    if (state == kRootState) {
+        std::copy(children, children + stride_, row);
+    } else {
+        // δ(s, c) es el hijo si existe y si no δ(fallo(s), c). Si la fila del
+        // estado de fallo está en la caché se reutiliza; puede ocupar este
+        // mismo hueco, por eso se lee cada celda antes de sobrescribirla.
+        const StateID fail_state = automaton_.fail[state];
+        const size_t fail_slot = fail_state & mask_;
+        const StateID* fail_row = tags_[fail_slot] == fail_state ?
+                                  &rows_[fail_slot * stride_] : nullptr;
+        for (size_t c = 0; c < stride_; ++c) {
+            if (children[c] != kRootState) {
+                row[c] = children[c];
+            } else {
+                row[c] = fail_row ? fail_row[c] : automaton_.step(fail_state, static_cast<int>(c));
+            }
+        }
+    }
+    tags_[slot] = state;
+}
+
+} // namespace ahocorasick
@@ -0,0 +1,174 @@
+#ifndef AUTOMATON_H
+#define AUTOMATON_H
+
+#include "PatternPool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ahocorasick {
+
+static constexpr int ALPHABET_SIZE = 28; // 26 letras + espacio + guión
+using PatternID = size_t;
+using StateID = uint32_t;
+static constexpr StateID kRootState = 0;
+static constexpr uint32_t kNoOutput = UINT32_MAX;
+// Clase de los bytes que no forman parte del alfabeto de letras.
+static constexpr uint8_t kNoClass = 0xFF;
+
+int char_to_index(char c);
+
+// Símbolos sobre los que trabaja el autómata.
+enum class Alphabet : uint8_t {
+    // Las 28 clases de char_to_index(): el texto se normaliza antes con
+    // clean_text(), que descarta el resto de bytes.
+    Letters,
+    // Bytes crudos: una clase por byte distinto de los patrones (las
+    // mayúsculas ASCII comparten la de su minúscula) y la clase 0 para los
+    // que no aparecen en ninguno. No se descarta nada.
+    Bytes,
+};
+
+// Arreglo de solo lectura que es propio o una vista sobre memoria ajena
+// (una instantánea proyectada con mmap). mutable_data() copia la vista la
+// primera vez que hace falta modificarlo.
+template <typename T>
+class Table {
+public:
+    const T* data() const { return view_ ? view_ : owned_.data(); }
+    size_t size() const { return view_ ? view_size_ : owned_.size(); }
+    const T& operator[](size_t index) const { return data()[index]; }
+
+    void reset() {
+        owned_.clear();
+        view_ = nullptr;
+        view_size_ = 0;
+    }
+    void view(const T* data, size_t size) {
+        owned_.clear();
+        view_ = data;
+        view_size_ = size;
+    }
+    std::vector<T>& mutable_data() {
+        if (view_) {
+            owned_.assign(view_, view_ + view_size_);
+            view_ = nullptr;
+            view_size_ = 0;
+        }
+        return owned_;
+    }
+
+private:
+    std::vector<T> owned_;
+    const T* view_ = nullptr;
+    size_t view_size_ = 0;
+};
+
+// Autómata de Aho-Corasick en tablas planas indexadas por estado. Solo
+// guarda índices, así que se puede volcar a disco y proyectar de nuevo en
+// cualquier dirección sin reconstruirlo.
+struct Automaton {
+    struct Output {
+        uint32_t pattern;
+        uint32_t next; // siguiente salida del mismo estado, o kNoOutput
+    };
+
+    // Se fija antes de build() y determina byte_class y stride.
+    Alphabet alphabet = Alphabet::Letters;
+    // Columna de transitions de cada byte (kNoClass si no tiene) y número de
+    // columnas. Plegar mayúsculas es parte de esta tabla, así que el texto
+    // crudo puede pasarse directamente a step().
+    std::array<uint8_t, 256> byte_class = letter_classes();
+    uint32_t stride = ALPHABET_SIZE;
+    // transitions[s * stride + c]: hijo en el trie, 0 si no existe (la raíz
+    // nunca es hija de nadie).
+    Table<StateID> transitions;
+    Table<StateID> fail;
+    // Estado más cercano en la cadena de fallos con salidas; 0 si ninguno.
+    Table<StateID> output_link;
+    Table<uint32_t> depth;
+    Table<uint32_t> out_head;
+    Table<Output> outputs;
+    uint32_t max_depth = 0;
+    // Mantiene viva la proyección cuando las tablas son vistas.
+    std::shared_ptr<const void> storage;
+    // Árbol de fallos inverso (primer hijo y hermanos; 0 = ninguno). Solo lo
+    // usan las inserciones incrementales y se construye la primera vez.
+    std::vector<StateID> fail_first_child;
+    std::vector<StateID> fail_next_sibling;
+    std::vector<StateID> fail_prev_sibling;
+
+    size_t state_count() const { return fail.size(); }
+    bool has_output(StateID state) const {
+        return out_head[state] != kNoOutput || output_link[state] != kRootState;
+    }
+    StateID step(StateID state, int idx) const {
+        const StateID* next = transitions.data();
+        while (state != kRootState && !next[state * stride + idx]) {
+            state = fail[state];
+        }
+        return next[state * stride + idx];
+    }
+
+    // char_to_index() en tabla.
+    static std::array<uint8_t, 256> letter_classes();
+
+    // Construye el trie y los enlaces de fallo a partir de patrones ya
+    // normalizados; los vacíos no generan estados. Cada estado final emite
+    // un único patrón, el primero con esa cadena: canonical[i] recibe ese
+    // patrón canónico (i mismo si no es un duplicado).
+    void build(const PatternPool& normalized, std::vector<PatternID>& canonical);
+    // Añade los patrones normalized[first..] sin reconstruir: crea los
+    // estados nuevos y solo recalcula los enlaces de fallo y de salida de
+    // los estados cuyo sufijo más largo cambia y de sus subárboles.
+    void insert(const PatternPool& normalized, PatternID first,
+                std::vector<PatternID>& canonical);
+    // Comprueba que los índices de una instantánea cargada son coherentes,
+    // de modo que step() y el recorrido de salidas siempre terminan.
+    void validate(size_t pattern_count) const;
+
+private:
+    // Con Alphabet::Bytes, da clase a los bytes nuevos de normalized[first..]
+    // y ensancha las filas existentes; devuelve si cambió stride.
+    bool add_classes(const PatternPool& normalized, PatternID first);
+};
+
+// DFA perezoso sobre un Automaton: la fila completa de transiciones de un
+// estado se calcula con el trie y los enlaces de fallo la primera vez que
+// el recorrido la necesita, y se guarda en una caché de tamaño acotado con
+// correspondencia directa (una fila nueva desaloja la que ocupaba su hueco).
+// Así step() no recorre enlaces de fallo en los estados calientes sin
+// compilar el DFA entero. Guarda estado mutable: una por hilo o Scanner.
+class TransitionCache {
+public:
+    // max_rows se redondea a potencia de dos y no pasa del número de estados.
+    TransitionCache(const Automaton& automaton, size_t max_rows);
+
+    StateID step(StateID state, int idx) {
+        const size_t slot = state & mask_;
+        if (tags_[slot] != state) fill(slot, state);
+        return rows_[slot * stride_ + idx];
+    }
+    size_t capacity() const { return tags_.size(); }
+    // Filas calculadas hasta ahora (incluidas las que se desalojaron).
+    size_t misses() const { return misses_; }
+
+private:
+    static constexpr StateID kEmptySlot = UINT32_MAX;
+
+    const Automaton& automaton_;
+    size_t stride_;
+    size_t mask_;
+    std::vector<StateID> tags_;
+    std::vector<StateID> rows_;
+    size_t misses_ = 0;
+
+    void fill(size_t slot, StateID state);
+};
+
+} // namespace ahocorasick
+
+#endif // AUTOMATON_H
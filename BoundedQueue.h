@@ -0,0 +1,119 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace ahocorasick {
+
+// Cola acotada MPMC sin bloqueos (anillo de Vyukov). push() y pop() esperan
+// con retroceso progresivo mientras la cola esté llena o vacía, lo que
+// propaga la contrapresión entre etapas.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Devuelve false si la cola se cerró antes de poder insertar.
+    bool push(T value) {
+        for (unsigned spins = 0; !try_push(value); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) return false;
+            backoff(spins);
+        }
+        return true;
+    }
+
+    // Devuelve false cuando la cola está cerrada y vacía.
+    bool pop(T& value) {
+        for (unsigned spins = 0; !try_pop(value); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) return try_pop(value);
+            backoff(spins);
+        }
+        return true;
+    }
+
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static void backoff(unsigned spins) {
+        if (spins < 64) return;
+        if (spins < 1024) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    std::atomic<bool> closed_{false};
+};
+
+} // namespace ahocorasick
+
+#endif // BOUNDED_QUEUE_H
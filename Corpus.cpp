@@ -0,0 +1,182 @@
+#include "Corpus.h"
+
+#include "BoundedQueue.h"
+#include "InputSource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace ahocorasick {
+
+namespace fs = std::filesystem;
+
+CorpusScanner::CorpusScanner(const PatternMatcher& matcher, CorpusOptions options)
+    : matcher_(matcher), options_(options) {
+    if (options_.chunk_size == 0) {
+        throw std::invalid_argument("El tamaño de trozo debe ser mayor que cero");
+    }
+    if (options_.threads == 0) {
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+std::vector<std::string> CorpusScanner::list_files(const std::string& root) {
+    std::vector<std::string> files;
+    if (fs::is_regular_file(root)) {
+        files.push_back(root);
+        return files;
+    }
+    if (!fs::is_directory(root)) {
+        throw std::runtime_error("No se encontró el archivo o directorio: " + root);
+    }
+    for (auto it = fs::recursive_directory_iterator(
+             root, fs::directory_options::skip_permission_denied);
+         it != fs::recursive_directory_iterator(); ++it) {
+        if (it->is_regular_file()) files.push_back(it->path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+CorpusScanner::TaskResult CorpusScanner::scan_task(const std::string& path,
+                                                   const Task& task,
+                                                   size_t index) const {
+    MappedFile file(path);
+    std::string_view text = file.view();
+
+    TaskResult result;
+    result.task = index;
+    Scanner scanner(matcher_, options_.context_size);
+    auto sink = [&](const MatchResult& match) { result.matches.push_back(match); };
+
+    if (detect_compression(text) != Compression::None) {
+        // Los archivos comprimidos no se dividen: se descomprimen en flujo.
+        DecompressingSource source(std::unique_ptr<BlockSource>(new PrefetchReader(path)));
+        for (std::string_view block = source.next(); !block.empty(); block = source.next()) {
+            result.newlines += static_cast<size_t>(std::count(block.begin(), block.end(), '\n'));
+            scanner.feed(block, sink);
+        }
+        scanner.finish(sink);
+        return result;
+    }
+
+    // El trozo contiene las líneas que empiezan en [begin, end).
+    size_t start = 0;
+    if (task.begin > 0) {
+        start = text.find('\n', task.begin - 1);
+        start = start == std::string_view::npos ? text.size() : start + 1;
+    }
+    size_t stop = text.size();
+    if (task.end < text.size()) {
+        stop = text.find('\n', task.end - 1);
+        stop = stop == std::string_view::npos ? text.size() : stop + 1;
+    }
+    start = std::min(start, stop);
+    std::string_view chunk = text.substr(start, stop - start);
+
+    result.newlines = static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+    scanner.feed(chunk, sink);
+    scanner.finish(sink);
+    for (auto& match : result.matches) match.offset += start;
+    return result;
+}
+
+size_t CorpusScanner::run(const std::string& root, const Sink& sink) {
+    const std::vector<std::string> files = list_files(root);
+    std::vector<Task> tasks;
+    for (size_t f = 0; f < files.size(); ++f) {
+        size_t size = static_cast<size_t>(fs::file_size(files[f]));
+        // Un archivo comprimido se procesa como un único trozo.
+        if (size > options_.chunk_size &&
+            detect_compression(MappedFile(files[f]).view().substr(0, 4)) != Compression::None) {
+            size = 0;
+        }
+        size_t begin = 0;
+        do {
+            size_t end = std::min(size, begin + options_.chunk_size);
+            tasks.push_back({f, begin, end});
+            begin = end;
+        } while (begin < size);
+    }
+
+    const size_t workers = std::min(options_.threads, std::max<size_t>(tasks.size(), 1));
+    const size_t max_in_flight = 4 * workers;
+    BoundedQueue<TaskResult> results(max_in_flight);
+    std::atomic<size_t> next_task{0};
+    std::atomic<size_t> emitted{0};
+    std::atomic<size_t> active_workers{workers};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = e;
+        }
+        failed.store(true);
+        results.close();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; ++w) {
+        threads.emplace_back([&]() {
+            try {
+                while (!failed.load()) {
+                    size_t index = next_task.fetch_add(1);
+                    if (index >= tasks.size()) break;
+                    for (unsigned spins = 0;
+                         index >= emitted.load() + max_in_flight && !failed.load(); ++spins) {
+                        if (spins < 1024) {
+                            std::this_thread::yield();
+                        } else {
+                            std::this_thread::sleep_for(std::chrono::microseconds(50));
+                        }
+                    }
+                    const Task& task = tasks[index];
+                    if (!results.push(scan_task(files[task.file], task, index))) break;
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            if (--active_workers == 0) results.close();
+        });
+    }
+
+    size_t total = 0;
+    try {
+        std::map<size_t, TaskResult> pending;
+        size_t next = 0;
+        size_t line_base = 0;
+        TaskResult result;
+        while (results.pop(result)) {
+            pending.emplace(result.task, std::move(result));
+            while (!pending.empty() && pending.begin()->first == next) {
+                TaskResult& ready = pending.begin()->second;
+                const Task& task = tasks[next];
+                if (task.begin == 0) line_base = 0;
+                for (auto& match : ready.matches) {
+                    match.line += line_base;
+                    sink(files[task.file], match);
+                    ++total;
+                }
+                line_base += ready.newlines;
+                pending.erase(pending.begin());
+                emitted.store(++next);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    for (auto& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+    return total;
+}
+
+} // namespace ahocorasick
@@ -0,0 +1,55 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "PatternMatcher.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ahocorasick {
+
+struct CorpusOptions {
+    size_t threads = 0;            // 0 = núcleos disponibles
+    size_t chunk_size = 8 << 20;   // archivos mayores se dividen en trozos
+    size_t context_size = 20;
+};
+
+// Busca en todos los archivos regulares bajo una ruta (recursivamente si es
+// un directorio). Los archivos se reparten entre hilos que comparten el
+// mismo autómata de solo lectura; los archivos grandes se dividen en trozos
+// cortados en saltos de línea. Las coincidencias se entregan agrupadas por
+// archivo, en orden de ruta, y con números de línea relativos al archivo.
+class CorpusScanner {
+public:
+    using Sink = std::function<void(const std::string& path, const MatchResult&)>;
+
+    explicit CorpusScanner(const PatternMatcher& matcher, CorpusOptions options = {});
+
+    // Devuelve el número total de coincidencias entregadas al sumidero.
+    size_t run(const std::string& root, const Sink& sink);
+
+    static std::vector<std::string> list_files(const std::string& root);
+
+private:
+    struct Task {
+        size_t file;
+        size_t begin;
+        size_t end;
+    };
+    struct TaskResult {
+        size_t task = 0;
+        size_t newlines = 0;
+        std::vector<MatchResult> matches;
+    };
+
+    const PatternMatcher& matcher_;
+    CorpusOptions options_;
+
+    TaskResult scan_task(const std::string& path, const Task& task, size_t index) const;
+};
+
+} // namespace ahocorasick
+
+#endif // CORPUS_H
@@ -0,0 +1,696 @@
+#include "InputSource.h"
+
+#include "BoundedQueue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef AHOCORASICK_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef AHOCORASICK_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define AHOCORASICK_HAVE_IO_URING 1
+#endif
+
+namespace ahocorasick {
+
+namespace {
+
+constexpr size_t kReadBlockSize = 1 << 20;
+constexpr size_t kReadAlignment = 4096;
+
+struct FileDescriptor {
+    int fd;
+    ~FileDescriptor() { if (fd >= 0) ::close(fd); }
+};
+
+std::runtime_error read_error(int error) {
+    return std::runtime_error(std::string("Error al leer la entrada: ") + std::strerror(error));
+}
+
+size_t pread_full(int fd, char* data, size_t size, size_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw read_error(errno);
+        }
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+} // namespace
+
+// Motor de lecturas asíncronas de PrefetchReader. Cada lectura se identifica
+// con una etiqueta (el número de bloque).
+class ReadBackend {
+public:
+    virtual ~ReadBackend() = default;
+    virtual bool uses_io_uring() const = 0;
+    virtual void submit(size_t tag, char* data, size_t size, size_t offset) = 0;
+    // Espera a que termine la lectura `tag` y devuelve los bytes leídos.
+    virtual size_t wait(size_t tag) = 0;
+};
+
+namespace {
+
+class ThreadReadBackend : public ReadBackend {
+public:
+    ThreadReadBackend(int fd, size_t depth)
+        : fd_(fd), requests_(depth + 1), completions_(depth + 1) {
+        worker_ = std::thread([this]() { run(); });
+    }
+
+    ~ThreadReadBackend() override {
+        requests_.close();
+        worker_.join();
+    }
+
+    bool uses_io_uring() const override { return false; }
+
+    void submit(size_t tag, char* data, size_t size, size_t offset) override {
+        if (!requests_.push({tag, data, size, offset})) {
+            throw std::runtime_error("El lector de fondo se detuvo");
+        }
+    }
+
+    size_t wait(size_t tag) override {
+        Completion completion;
+        while (completions_.pop(completion)) {
+            if (completion.error) std::rethrow_exception(completion.error);
+            if (completion.tag == tag) return completion.size;
+        }
+        throw std::runtime_error("El lector de fondo se detuvo");
+    }
+
+private:
+    struct Request {
+        size_t tag = 0;
+        char* data = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+    };
+    struct Completion {
+        size_t tag = 0;
+        size_t size = 0;
+        std::exception_ptr error;
+    };
+
+    int fd_;
+    BoundedQueue<Request> requests_;
+    BoundedQueue<Completion> completions_;
+    std::thread worker_;
+
+    void run() {
+        Request request;
+        while (requests_.pop(request)) {
+            Completion completion;
+            completion.tag = request.tag;
+            try {
+                completion.size = pread_full(fd_, request.data, request.size, request.offset);
+            } catch (...) {
+                completion.error = std::current_exception();
+            }
+            if (!completions_.push(std::move(completion))) break;
+        }
+        completions_.close();
+    }
+};
+
+#ifdef AHOCORASICK_HAVE_IO_URING
+// io_uring mediante llamadas al sistema directas (sin liburing).
+class UringReadBackend : public ReadBackend {
+public:
+    static std::unique_ptr<ReadBackend> create(int fd, size_t depth) {
+        std::unique_ptr<UringReadBackend> backend(new UringReadBackend(fd));
+        if (!backend->setup(static_cast<unsigned>(depth))) return nullptr;
+        return backend;
+    }
+
+    ~UringReadBackend() override {
+        // Las lecturas en vuelo escriben en los buffers del lector: hay que
+        // esperarlas antes de liberarlos.
+        try {
+            while (!pending_.empty()) wait(pending_.begin()->first);
+        } catch (...) {
+        }
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) ::munmap(sq_ptr_, sq_size_);
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+    }
+
+    bool uses_io_uring() const override { return true; }
+
+    void submit(size_t tag, char* data, size_t size, size_t offset) override {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & *sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<unsigned long long>(data);
+        sqe.len = static_cast<unsigned>(size);
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        pending_[tag] = {data, size, offset};
+        while (enter(1, 0, 0) < 0) {
+            if (errno != EINTR && errno != EAGAIN) throw read_error(errno);
+        }
+    }
+
+    size_t wait(size_t tag) override {
+        while (true) {
+            auto done = done_.find(tag);
+            if (done != done_.end()) {
+                int res = done->second;
+                done_.erase(done);
+                Request request = pending_[tag];
+                pending_.erase(tag);
+                if (res < 0) throw read_error(-res);
+                size_t size = static_cast<size_t>(res);
+                if (size < request.size) {
+                    size += pread_full(fd_, request.data + size, request.size - size,
+                                       request.offset + size);
+                }
+                return size;
+            }
+            reap();
+        }
+    }
+
+private:
+    struct Request {
+        char* data = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+    };
+
+    int fd_;
+    int ring_fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    std::map<size_t, Request> pending_;
+    std::map<size_t, int> done_;
+
+    explicit UringReadBackend(int fd) : fd_(fd) {}
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                          min_complete, flags, nullptr, 0));
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0) return false;
+        // IORING_OP_READ llegó junto con IORING_FEAT_FAST_POLL (Linux 5.6/5.7).
+        if (!(params.features & IORING_FEAT_FAST_POLL)) return false;
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+        sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            return false;
+        }
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                cq_ptr_ = nullptr;
+                return false;
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        char* cq = static_cast<char*>(cq_ptr_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void reap() {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                throw read_error(errno);
+            }
+            return;
+        }
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            done_[cqe.user_data] = cqe.res;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+};
+#endif
+
+} // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+    FileDescriptor file{::open(path.c_str(), O_RDONLY)};
+    if (file.fd < 0) {
+        throw std::runtime_error("No se pudo abrir el archivo de texto: " + path);
+    }
+
+    struct stat info;
+    if (::fstat(file.fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) return;
+        void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                            MAP_PRIVATE, file.fd, 0);
+        if (data != MAP_FAILED) {
+            ::madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            data_ = data;
+            size_ = static_cast<size_t>(info.st_size);
+            return;
+        }
+    }
+
+    // Tuberías, dispositivos o mmap no disponible: lectura por bloques.
+    size_t used = 0;
+    while (true) {
+        if (buffer_.size() - used < kReadBlockSize) buffer_.resize(used + kReadBlockSize);
+        ssize_t n = ::read(file.fd, &buffer_[used], buffer_.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Error al leer el archivo de texto: " + path +
+                                     " (" + std::strerror(errno) + ")");
+        }
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+    }
+    buffer_.resize(used);
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      buffer_(std::move(other.buffer_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+std::string_view MappedFile::view() const {
+    if (data_) return std::string_view(static_cast<const char*>(data_), size_);
+    return buffer_;
+}
+
+void MappedFile::release() {
+    if (data_) ::munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+BlockReader::BlockReader(int fd, size_t block_size)
+    : fd_(fd), owns_fd_(false), buffer_(block_size, '\0') {}
+
+BlockReader::BlockReader(const std::string& path, size_t block_size)
+    : fd_(path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY)),
+      owns_fd_(path != "-"), buffer_(block_size, '\0') {
+    if (fd_ < 0) {
+        throw std::runtime_error("No se pudo abrir el archivo de texto: " + path);
+    }
+}
+
+BlockReader::~BlockReader() {
+    if (owns_fd_) ::close(fd_);
+}
+
+std::string_view BlockReader::next() {
+    while (true) {
+        ssize_t n = ::read(fd_, &buffer_[0], buffer_.size());
+        if (n >= 0) return std::string_view(buffer_.data(), static_cast<size_t>(n));
+        if (errno != EINTR) {
+            throw std::runtime_error(std::string("Error al leer la entrada: ") +
+                                     std::strerror(errno));
+        }
+    }
+}
+
+void PrefetchReader::FreeDeleter::operator()(char* p) const { std::free(p); }
+
+PrefetchReader::PrefetchReader(const std::string& path, size_t block_size,
+                               size_t depth, bool allow_io_uring)
+    : block_size_((std::max<size_t>(block_size, 1) + kReadAlignment - 1) /
+                  kReadAlignment * kReadAlignment) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("No se pudo abrir el archivo de texto: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd_, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd_);
+        throw std::invalid_argument("PrefetchReader solo admite archivos regulares: " + path);
+    }
+    file_size_ = static_cast<size_t>(info.st_size);
+    block_count_ = (file_size_ + block_size_ - 1) / block_size_;
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    depth = std::max<size_t>(1, std::min(depth, std::max<size_t>(block_count_, 1)));
+    for (size_t i = 0; i < depth; ++i) {
+        void* data = nullptr;
+        if (::posix_memalign(&data, kReadAlignment, block_size_) != 0) {
+            ::close(fd_);
+            throw std::bad_alloc();
+        }
+        buffers_.emplace_back(static_cast<char*>(data));
+    }
+
+#ifdef AHOCORASICK_HAVE_IO_URING
+    if (allow_io_uring) backend_ = UringReadBackend::create(fd_, depth);
+#else
+    (void)allow_io_uring;
+#endif
+    if (!backend_) backend_.reset(new ThreadReadBackend(fd_, depth));
+    for (size_t block = 0; block < std::min(depth, block_count_); ++block) {
+        submit(block);
+    }
+}
+
+PrefetchReader::~PrefetchReader() {
+    backend_.reset();
+    ::close(fd_);
+}
+
+bool PrefetchReader::uses_io_uring() const { return backend_->uses_io_uring(); }
+
+std::string_view PrefetchReader::next() {
+    // El buffer del bloque anterior ya está libre: se reutiliza para leer
+    // el bloque que queda `depth` posiciones por delante.
+    if (next_block_ > 0 && next_block_ - 1 + buffers_.size() < block_count_) {
+        submit(next_block_ - 1 + buffers_.size());
+    }
+    if (next_block_ >= block_count_) return {};
+    const size_t size = backend_->wait(next_block_);
+    const char* data = buffers_[next_block_ % buffers_.size()].get();
+    ++next_block_;
+    return std::string_view(data, size);
+}
+
+void PrefetchReader::submit(size_t block) {
+    const size_t offset = block * block_size_;
+    backend_->submit(block, buffers_[block % buffers_.size()].get(),
+                     std::min(block_size_, file_size_ - offset), offset);
+}
+
+Compression detect_compression(std::string_view data) {
+    if (data.size() >= 2 && data[0] == '\x1f' && data[1] == '\x8b') return Compression::Gzip;
+    if (data.size() >= 4 && data.compare(0, 4, "\x28\xb5\x2f\xfd") == 0) return Compression::Zstd;
+    return Compression::None;
+}
+
+namespace {
+
+// Destino de la salida descomprimida: entrega cada bloque lleno a la cola.
+class BlockWriter {
+public:
+    // Se lanza cuando el consumidor cerró la cola y ya no quiere más datos.
+    struct Stopped {};
+
+    BlockWriter(BoundedQueue<std::string>& filled, BoundedQueue<std::string>& recycled)
+        : filled_(filled), recycled_(recycled) {
+        take_buffer();
+    }
+
+    char* space() { return &buffer_[used_]; }
+    size_t available() const { return buffer_.size() - used_; }
+
+    void commit(size_t n) {
+        used_ += n;
+        if (used_ == buffer_.size()) flush();
+    }
+
+    void flush() {
+        if (used_ == 0) return;
+        buffer_.resize(used_);
+        if (!filled_.push(std::move(buffer_))) throw Stopped();
+        take_buffer();
+    }
+
+private:
+    BoundedQueue<std::string>& filled_;
+    BoundedQueue<std::string>& recycled_;
+    std::string buffer_;
+    size_t used_ = 0;
+
+    void take_buffer() {
+        if (!recycled_.try_pop(buffer_)) buffer_.clear();
+        buffer_.resize(DecompressingSource::kBlockSize);
+        used_ = 0;
+    }
+};
+
+class Decoder {
+public:
+    virtual ~Decoder() = default;
+    virtual void decode(std::string_view input, BlockWriter& out) = 0;
+    virtual void finish() = 0;
+};
+
+#ifdef AHOCORASICK_WITH_ZLIB
+class GzipDecoder : public Decoder {
+public:
+    GzipDecoder() {
+        // 15 + 32: ventana máxima y detección automática de cabecera gzip/zlib.
+        if (inflateInit2(&stream_, 15 + 32) != Z_OK) {
+            throw std::runtime_error("No se pudo inicializar zlib");
+        }
+    }
+    ~GzipDecoder() override { inflateEnd(&stream_); }
+
+    void decode(std::string_view input, BlockWriter& out) override {
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream_.avail_in = static_cast<uInt>(input.size());
+        do {
+            if (ended_) {
+                // Varios miembros gzip concatenados forman un único flujo.
+                if (stream_.avail_in == 0) break;
+                inflateReset(&stream_);
+                ended_ = false;
+            }
+            const size_t available = out.available();
+            stream_.next_out = reinterpret_cast<Bytef*>(out.space());
+            stream_.avail_out = static_cast<uInt>(available);
+            int ret = inflate(&stream_, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                ended_ = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Datos gzip corruptos: ") +
+                                         (stream_.msg ? stream_.msg : "error de zlib"));
+            }
+            out.commit(available - stream_.avail_out);
+        } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+    }
+
+    void finish() override {
+        if (!ended_) throw std::runtime_error("El flujo gzip está incompleto");
+    }
+
+private:
+    z_stream stream_{};
+    bool ended_ = false;
+};
+#endif
+
+#ifdef AHOCORASICK_WITH_ZSTD
+class ZstdDecoder : public Decoder {
+public:
+    ZstdDecoder() : stream_(ZSTD_createDStream()) {
+        if (!stream_) throw std::bad_alloc();
+        ZSTD_initDStream(stream_);
+    }
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream_); }
+
+    void decode(std::string_view input, BlockWriter& out) override {
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        bool full;
+        do {
+            ZSTD_outBuffer output{out.space(), out.available(), 0};
+            size_t ret = ZSTD_decompressStream(stream_, &output, &in);
+            if (ZSTD_isError(ret)) {
+                throw std::runtime_error(std::string("Datos zstd corruptos: ") +
+                                         ZSTD_getErrorName(ret));
+            }
+            remaining_ = ret;
+            full = output.pos == output.size;
+            out.commit(output.pos);
+        } while (in.pos < in.size || full);
+    }
+
+    void finish() override {
+        if (remaining_ != 0) throw std::runtime_error("El flujo zstd está incompleto");
+    }
+
+private:
+    ZSTD_DStream* stream_;
+    size_t remaining_ = 0;
+};
+#endif
+
+std::unique_ptr<Decoder> make_decoder(Compression compression) {
+    switch (compression) {
+        case Compression::Gzip:
+#ifdef AHOCORASICK_WITH_ZLIB
+            return std::unique_ptr<Decoder>(new GzipDecoder());
+#else
+            throw std::runtime_error("La entrada está comprimida con gzip, pero el programa "
+                                     "se compiló sin soporte (-DAHOCORASICK_WITH_ZLIB -lz)");
+#endif
+        case Compression::Zstd:
+#ifdef AHOCORASICK_WITH_ZSTD
+            return std::unique_ptr<Decoder>(new ZstdDecoder());
+#else
+            throw std::runtime_error("La entrada está comprimida con zstd, pero el programa "
+                                     "se compiló sin soporte (-DAHOCORASICK_WITH_ZSTD -lzstd)");
+#endif
+        case Compression::None:
+            break;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+struct DecompressingSource::Worker {
+    BoundedQueue<std::string> filled{4};
+    BoundedQueue<std::string> recycled{4};
+    std::string current;
+    std::exception_ptr error;
+    std::thread thread;
+};
+
+DecompressingSource::DecompressingSource(std::unique_ptr<BlockSource> inner)
+    : inner_(std::move(inner)) {
+    first_block_ = inner_->next();
+    if (!first_block_.empty() && first_block_.size() < 4) {
+        // Una tubería puede entregar menos bytes que el número mágico.
+        head_.assign(first_block_.data(), first_block_.size());
+        for (std::string_view more = inner_->next(); !more.empty(); more = inner_->next()) {
+            head_.append(more.data(), more.size());
+            if (head_.size() >= 4) break;
+        }
+        first_block_ = head_;
+    }
+    compression_ = detect_compression(first_block_);
+    if (compression_ == Compression::None) return;
+
+    std::shared_ptr<Decoder> decoder(make_decoder(compression_));
+    worker_.reset(new Worker());
+    Worker& worker = *worker_;
+    worker.thread = std::thread([this, &worker, decoder]() {
+        try {
+            BlockWriter out(worker.filled, worker.recycled);
+            for (std::string_view block = first_block_; !block.empty(); block = inner_->next()) {
+                decoder->decode(block, out);
+            }
+            decoder->finish();
+            out.flush();
+        } catch (const BlockWriter::Stopped&) {
+        } catch (...) {
+            worker.error = std::current_exception();
+        }
+        worker.filled.close();
+    });
+}
+
+DecompressingSource::~DecompressingSource() {
+    if (worker_) {
+        worker_->filled.close();
+        worker_->recycled.close();
+        worker_->thread.join();
+    }
+}
+
+std::string_view DecompressingSource::next() {
+    if (!worker_) {
+        if (first_pending_) {
+            first_pending_ = false;
+            if (!first_block_.empty()) return first_block_;
+        }
+        return inner_->next();
+    }
+    if (!worker_->current.empty()) {
+        worker_->recycled.try_push(worker_->current);
+        worker_->current.clear();
+    }
+    if (worker_->filled.pop(worker_->current)) return worker_->current;
+    if (worker_->error) std::rethrow_exception(worker_->error);
+    return {};
+}
+
+std::unique_ptr<BlockSource> open_block_source(const std::string& path) {
+    std::unique_ptr<BlockSource> source;
+    struct stat info;
+    if (path != "-" && ::stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+        source.reset(new PrefetchReader(path));
+    } else {
+        source.reset(new BlockReader(path));
+    }
+    return std::unique_ptr<BlockSource>(new DecompressingSource(std::move(source)));
+}
+
+} // namespace ahocorasick
@@ -0,0 +1,150 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ahocorasick {
+
+// Texto de entrada de solo lectura. Los archivos regulares se proyectan en
+// memoria con mmap (MADV_SEQUENTIAL) y no ocupan memoria privada; las
+// tuberías y dispositivos se leen por bloques a un buffer propio.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const;
+    size_t size() const { return view().size(); }
+    bool mapped() const { return data_ != nullptr; }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    std::string buffer_;
+
+    void release();
+};
+
+// Fuente de bloques de texto consecutivos para el escáner.
+class BlockSource {
+public:
+    virtual ~BlockSource() = default;
+    // Devuelve el siguiente bloque, válido hasta la próxima llamada; una
+    // vista vacía indica el final de la entrada.
+    virtual std::string_view next() = 0;
+};
+
+// Lee un archivo, una tubería o la entrada estándar en bloques de tamaño
+// fijo, de modo que la memoria usada no depende del tamaño de la entrada.
+class BlockReader : public BlockSource {
+public:
+    static constexpr size_t kDefaultBlockSize = 1 << 16;
+
+    explicit BlockReader(int fd, size_t block_size = kDefaultBlockSize);
+    // "-" lee de la entrada estándar.
+    explicit BlockReader(const std::string& path, size_t block_size = kDefaultBlockSize);
+    ~BlockReader() override;
+
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    std::string_view next() override;
+
+private:
+    int fd_;
+    bool owns_fd_;
+    std::string buffer_;
+};
+
+class ReadBackend;
+
+// Lector de archivos regulares que mantiene `depth` lecturas alineadas en
+// vuelo, de modo que el siguiente bloque ya está en memoria cuando el
+// escáner termina con el actual. Usa io_uring si el núcleo lo admite y, si
+// no, un hilo de fondo con pread().
+class PrefetchReader : public BlockSource {
+public:
+    static constexpr size_t kDefaultBlockSize = 1 << 20;
+    static constexpr size_t kDefaultDepth = 4;
+
+    explicit PrefetchReader(const std::string& path,
+                            size_t block_size = kDefaultBlockSize,
+                            size_t depth = kDefaultDepth,
+                            bool allow_io_uring = true);
+    ~PrefetchReader() override;
+
+    PrefetchReader(const PrefetchReader&) = delete;
+    PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+    std::string_view next() override;
+    bool uses_io_uring() const;
+
+private:
+    struct FreeDeleter {
+        void operator()(char* p) const;
+    };
+
+    int fd_ = -1;
+    size_t file_size_ = 0;
+    size_t block_size_;
+    size_t block_count_ = 0;
+    size_t next_block_ = 0;
+    std::vector<std::unique_ptr<char, FreeDeleter>> buffers_;
+    std::unique_ptr<ReadBackend> backend_;
+
+    void submit(size_t block);
+};
+
+enum class Compression { None, Gzip, Zstd };
+
+// Detecta gzip o zstd por el número mágico al inicio de los datos.
+Compression detect_compression(std::string_view data);
+
+// Descomprime al vuelo otra fuente de bloques. El formato se detecta con el
+// primer bloque; si los datos no están comprimidos se entregan tal cual. La
+// descompresión corre en un hilo propio, en paralelo con el escáner, y le
+// entrega bloques a través de una cola acotada.
+//
+// gzip requiere compilar con -DAHOCORASICK_WITH_ZLIB -lz y zstd con
+// -DAHOCORASICK_WITH_ZSTD -lzstd.
+class DecompressingSource : public BlockSource {
+public:
+    static constexpr size_t kBlockSize = 1 << 20;
+
+    explicit DecompressingSource(std::unique_ptr<BlockSource> inner);
+    ~DecompressingSource() override;
+
+    DecompressingSource(const DecompressingSource&) = delete;
+    DecompressingSource& operator=(const DecompressingSource&) = delete;
+
+    std::string_view next() override;
+    Compression compression() const { return compression_; }
+
+private:
+    struct Worker;
+
+    std::unique_ptr<BlockSource> inner_;
+    Compression compression_ = Compression::None;
+    std::string_view first_block_;
+    std::string head_;
+    bool first_pending_ = true;
+    std::unique_ptr<Worker> worker_;
+};
+
+// Elige el lector adecuado: PrefetchReader para archivos regulares y
+// BlockReader para la entrada estándar ("-"), tuberías y dispositivos; la
+// entrada comprimida con gzip o zstd se descomprime automáticamente.
+std::unique_ptr<BlockSource> open_block_source(const std::string& path);
+
+} // namespace ahocorasick
+
+#endif // INPUT_SOURCE_H
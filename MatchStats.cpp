@@ -0,0 +1,58 @@
+#include "MatchStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ahocorasick {
+
+MatchStats::MatchStats(size_t pattern_count, size_t lines_per_bucket)
+    : counts_(pattern_count, 0), lines_per_bucket_(lines_per_bucket) {
+    if (lines_per_bucket_ == 0) {
+        throw std::invalid_argument("El histograma necesita al menos una línea por intervalo");
+    }
+}
+
+void MatchStats::add(PatternID pattern_id, size_t line) {
+    if (pattern_id >= counts_.size()) counts_.resize(pattern_id + 1, 0);
+    counts_[pattern_id]++;
+
+    size_t bucket = (line > 0 ? line - 1 : 0) / lines_per_bucket_;
+    if (bucket >= histogram_.size()) histogram_.resize(bucket + 1, 0);
+    histogram_[bucket]++;
+
+    if (total_ == 0 || line < first_line_) first_line_ = line;
+    if (total_ == 0 || line > last_line_) last_line_ = line;
+    total_++;
+}
+
+void MatchStats::merge(const MatchStats& other) {
+    if (other.lines_per_bucket_ != lines_per_bucket_) {
+        throw std::invalid_argument("No se pueden combinar histogramas con intervalos distintos");
+    }
+    if (other.empty()) return;
+
+    if (counts_.size() < other.counts_.size()) counts_.resize(other.counts_.size(), 0);
+    for (size_t i = 0; i < other.counts_.size(); ++i) counts_[i] += other.counts_[i];
+    if (histogram_.size() < other.histogram_.size()) histogram_.resize(other.histogram_.size(), 0);
+    for (size_t i = 0; i < other.histogram_.size(); ++i) histogram_[i] += other.histogram_[i];
+
+    first_line_ = empty() ? other.first_line_ : std::min(first_line_, other.first_line_);
+    last_line_ = empty() ? other.last_line_ : std::max(last_line_, other.last_line_);
+    total_ += other.total_;
+}
+
+MatchStats MatchStats::merge_tree(std::vector<MatchStats> shards) {
+    if (shards.empty()) return MatchStats();
+    for (size_t stride = 1; stride < shards.size(); stride *= 2) {
+        for (size_t i = 0; i + stride < shards.size(); i += 2 * stride) {
+            shards[i].merge(shards[i + stride]);
+        }
+    }
+    return std::move(shards.front());
+}
+
+size_t MatchStats::count(PatternID pattern_id) const {
+    return pattern_id < counts_.size() ? counts_[pattern_id] : 0;
+}
+
+} // namespace ahocorasick
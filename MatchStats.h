@@ -0,0 +1,44 @@
+#ifndef MATCH_STATS_H
+#define MATCH_STATS_H
+
+#include "PatternMatcher.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ahocorasick {
+
+// Estadísticas reducibles: cada hilo llena su propia instancia sin
+// sincronización y al final se combinan en árbol con merge_tree().
+class MatchStats {
+public:
+    explicit MatchStats(size_t pattern_count = 0, size_t lines_per_bucket = 100);
+
+    void add(PatternID pattern_id, size_t line);
+    void add(const MatchResult& match) { add(match.pattern_id, match.line); }
+    void merge(const MatchStats& other);
+    static MatchStats merge_tree(std::vector<MatchStats> shards);
+
+    bool empty() const { return total_ == 0; }
+    size_t total() const { return total_; }
+    size_t count(PatternID pattern_id) const;
+    const std::vector<size_t>& counts() const { return counts_; }
+    size_t first_line() const { return first_line_; }
+    size_t last_line() const { return last_line_; }
+    size_t lines_per_bucket() const { return lines_per_bucket_; }
+    // histogram()[i] cuenta las coincidencias en las líneas
+    // [i * lines_per_bucket() + 1, (i + 1) * lines_per_bucket()].
+    const std::vector<size_t>& histogram() const { return histogram_; }
+
+private:
+    std::vector<size_t> counts_;
+    std::vector<size_t> histogram_;
+    size_t lines_per_bucket_;
+    size_t total_ = 0;
+    size_t first_line_ = 0;
+    size_t last_line_ = 0;
+};
+
+} // namespace ahocorasick
+
+#endif // MATCH_STATS_H
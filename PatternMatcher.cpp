@@ -1,18 +1,85 @@
 #include "PatternMatcher.h"
 
+#include "InputSource.h"
+#include "Snapshot.h"
+
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace ahocorasick {
 
-int char_to_index(char c) {
-    if (c == ' ') return 26;
-    if (c == '-') return 27;
-    if (c >= 'a' && c <= 'z') return c - 'a';
-    if (c >= 'A' && c <= 'Z') return std::tolower(c) - 'a';
-    return -1;
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'A', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+// Versión 2: añade la tabla canónica y las lápidas; versión 3: las opciones
+// de cada patrón; versión 4: la tabla de clases de bytes. Se siguen leyendo
+// las anteriores.
+constexpr uint32_t kSnapshotVersion = 4;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr uint32_t kCaseSensitiveFlag = 1;
+constexpr uint32_t kRawBytesFlag = 2;
+constexpr uint8_t kKnownPatternFlags = kMatchCase | kWholeWord;
+
+size_t align8(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+void write_section(std::ostream& out, size_t& pos, size_t offset, const void* data, size_t bytes) {
+    static const char padding[8] = {};
+    out.write(padding, static_cast<std::streamsize>(offset - pos));
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    pos = offset + bytes;
+}
+
+void write_offsets(std::ostream& out, size_t& pos, size_t offset, const PatternPool& pool) {
+    const std::vector<uint64_t> offsets(pool.offsets().begin(), pool.offsets().end());
+    write_section(out, pos, offset, offsets.data(), offsets.size() * sizeof(uint64_t));
+}
+
+template <typename T>
+const T* section_data(std::string_view data, size_t offset) {
+    return reinterpret_cast<const T*>(data.data() + offset);
+}
+
+std::runtime_error corrupt_snapshot(const std::string& path) {
+    return std::runtime_error("Instantánea del autómata corrupta: " + path);
+}
+
+} // namespace
+
+SnapshotLayout snapshot_layout(const SnapshotHeader& header) {
+    SnapshotLayout layout;
+    size_t pos = align8(sizeof(SnapshotHeader));
+    auto section = [&](size_t bytes) {
+        const size_t start = pos;
+        pos = align8(pos + bytes);
+        return start;
+    };
+    const size_t states = header.state_count;
+    layout.transitions = section(states * header.alphabet_size * sizeof(StateID));
+    layout.fail = section(states * sizeof(StateID));
+    layout.output_link = section(states * sizeof(StateID));
+    layout.depth = section(states * sizeof(uint32_t));
+    layout.out_head = section(states * sizeof(uint32_t));
+    layout.outputs = section(header.output_count * sizeof(Automaton::Output));
+    layout.pattern_offsets = section((header.pattern_count + 1) * sizeof(uint64_t));
+    layout.pattern_bytes = section(header.pattern_bytes);
+    layout.normalized_offsets = section((header.pattern_count + 1) * sizeof(uint64_t));
+    layout.normalized_bytes = section(header.normalized_bytes);
+    layout.canonical = layout.removed = layout.flags = pos;
+    if (header.version >= 2) {
+        layout.canonical = section(header.pattern_count * sizeof(uint32_t));
+        layout.removed = layout.flags = section(header.pattern_count);
+    }
+    if (header.version >= 3) layout.flags = section(header.pattern_count);
+    layout.byte_class = pos;
+    if (header.version >= 4) layout.byte_class = section(256);
+    layout.end = pos;
+    return layout;
 }
 
 bool MatchResult::operator<(const MatchResult& other) const {
@@ -21,76 +88,461 @@ bool MatchResult::operator<(const MatchResult& other) const {
 }
 
 PatternMatcher::PatternMatcher(bool verbose, bool case_sensitive)
-    : root_(new TrieNode()), verbose_(verbose), case_sensitive_(case_sensitive) {
-    root_->depth = 0;
+    : verbose_(verbose), case_sensitive_(case_sensitive) {
+    build_normalization();
+}
+
+void PatternMatcher::set_case_sensitive(bool case_sensitive) {
+    if (case_sensitive == case_sensitive_) return;
+    // La compactación en curso normalizó con la tabla anterior.
+    wait_for_compaction();
+    auto start_time = HighResClock::now();
+    case_sensitive_ = case_sensitive;
+    build_normalization();
+    if (patterns_.empty()) return;
+    normalize_patterns();
+    if (verbose_) {
+        auto end_time = HighResClock::now();
+        auto duration = std::chrono::duration_cast<TimeDuration>(end_time - start_time);
+        std::cout << "[INFO] Patrones renormalizados en " << duration.count()
+                  << " ms (sin reconstruir el autómata)\n";
+    }
+}
+
+void PatternMatcher::set_alphabet(Alphabet alphabet) {
+    if (alphabet == automaton_.alphabet) return;
+    wait_for_compaction();
+    auto start_time = HighResClock::now();
+    automaton_.alphabet = alphabet;
+    build_normalization();
+    if (patterns_.empty()) return;
+    // Los retirados siguen en el autómata nuevo y conservan su lápida.
+    normalize_patterns();
+    automaton_.build(normalized_patterns_, canonical_);
+    link_aliases(0);
+    select_engine();
+    if (verbose_) {
+        auto end_time = HighResClock::now();
+        auto duration = std::chrono::duration_cast<TimeDuration>(end_time - start_time);
+        std::cout << "[INFO] Autómata reconstruido en " << duration.count() << " ms ("
+                  << automaton_.stride << " clases de bytes)\n";
+    }
+}
+
+void PatternMatcher::build_normalization() {
+    for (int c = 0; c < 256; ++c) {
+        word_byte_[c] = std::isalnum(c) || c == '_' || c >= 0x80;
+        if (raw_bytes()) {
+            // Nada que limpiar: las mayúsculas se pliegan en las clases del autómata.
+            exact_[c] = normalized_[c] = static_cast<char>(c);
+            continue;
+        }
+        if (std::isalpha(c)) {
+            exact_[c] = static_cast<char>(c);
+        } else if (c == ' ' || c == '-' || c == '\n') {
+            exact_[c] = static_cast<char>(c);
+        } else if (c == '\t') {
+            exact_[c] = ' ';
+        } else {
+            exact_[c] = '\0';
+        }
+        normalized_[c] = case_sensitive_ ? exact_[c] :
+                         static_cast<char>(std::tolower(static_cast<unsigned char>(exact_[c])));
+    }
+}
+
+void PatternMatcher::set_pattern_flags(PatternID id, uint8_t flags) {
+    check_id(id);
+    if (flags & ~kKnownPatternFlags) {
+        throw std::invalid_argument("Opciones de patrón desconocidas");
+    }
+    update_flag_counts(flags_[id], -1);
+    update_flag_counts(flags, 1);
+    flags_[id] = flags;
+}
+
+void PatternMatcher::update_flag_counts(uint8_t flags, int delta) {
+    if (flags & kMatchCase) match_case_count_ += delta;
+    if (flags & kWholeWord) word_flag_count_ += delta;
+}
+
+bool PatternMatcher::accepts(PatternID id, const char* text,
+                             bool word_before, bool word_after) const {
+    if (removed_[id]) return false;
+    const uint8_t flags = flags_[id];
+    if (((flags & kWordStart) && word_before) || ((flags & kWordEnd) && word_after)) {
+        return false;
+    }
+    if (!case_sensitive_ && !(flags & kMatchCase)) return true;
+    // El autómata ya comparó sin distinguir mayúsculas; falta el caso exacto.
+    std::string_view pattern = patterns_[id];
+    if (raw_bytes()) return std::memcmp(text, pattern.data(), pattern.size()) == 0;
+    for (unsigned char c : pattern) {
+        const char n = exact_[c];
+        if (n != '\0' && n != *text++) return false;
+    }
+    return true;
 }
 
 void PatternMatcher::initialize(const std::vector<std::string>& patterns) {
+    initialize(PatternPool(patterns));
+}
+
+void PatternMatcher::initialize(std::vector<std::string>&& patterns) {
+    initialize(PatternPool(std::move(patterns)));
+}
+
+void PatternMatcher::initialize(const PatternPool& patterns) {
+    initialize(PatternPool(patterns));
+}
+
+void PatternMatcher::initialize(PatternPool&& patterns) {
     if (patterns.empty()) {
         throw std::invalid_argument("La lista de patrones no puede estar vacía");
     }
 
-    patterns_ = patterns;
-    clear_trie();
+    // Una compactación pendiente se refiere a los patrones anteriores.
+    compaction_ = {};
+    patterns_ = std::move(patterns);
+    removed_.assign(patterns_.size(), 0);
+    flags_.assign(patterns_.size(), 0);
+    match_case_count_ = 0;
+    word_flag_count_ = 0;
+    tombstones_ = 0;
 
     auto build_start = HighResClock::now();
-    build_trie();
-    build_failure_links();
+    normalize_patterns();
+    automaton_.build(normalized_patterns_, canonical_);
+    link_aliases(0);
+    select_engine();
 
     if (verbose_) {
         auto build_end = HighResClock::now();
         auto duration = std::chrono::duration_cast<TimeDuration>(build_end - build_start);
         std::cout << "[INFO] Autómata construido en " << duration.count() << " ms\n";
-        std::cout << "[INFO] Total de nodos creados: " << node_count_ << "\n";
-        std::cout << "[INFO] Profundidad máxima del trie: " << max_depth_ << "\n";
+        std::cout << "[INFO] Total de nodos creados: " << node_count() << "\n";
+        std::cout << "[INFO] Profundidad máxima del trie: " << max_depth() << "\n";
     }
 }
 
-std::string PatternMatcher::clean_text(const std::string& text) const {
+void PatternMatcher::add_patterns(const std::vector<std::string>& patterns) {
+    add_patterns(PatternPool(patterns));
+}
+
+void PatternMatcher::add_patterns(const PatternPool& patterns) {
+    if (patterns_.empty()) {
+        initialize(patterns);
+        return;
+    }
+    if (compaction_ready()) install_compaction();
+    auto insert_start = HighResClock::now();
+    const PatternID first = patterns_.size();
+    patterns_.append(patterns);
+    removed_.resize(patterns_.size(), 0);
+    flags_.resize(patterns_.size(), 0);
     std::string cleaned;
-    cleaned.reserve(text.size());
+    for (std::string_view pattern : patterns) {
+        cleaned.clear();
+        clean_into(pattern, cleaned, normalized_);
+        normalized_patterns_.add(cleaned);
+    }
+    automaton_.insert(normalized_patterns_, first, canonical_);
+    link_aliases(first);
+    select_engine();
 
-    for (unsigned char c : text) {
-        if (std::isalpha(c)) {
-            cleaned += case_sensitive_ ? c : std::tolower(c);
-        } else if (c == ' ' || c == '-' || c == '\n') {
-            cleaned += c;
-        } else if (c == '\t') {
-            cleaned += ' ';
-        }
+    if (verbose_) {
+        auto insert_end = HighResClock::now();
+        auto duration = std::chrono::duration_cast<TimeDuration>(insert_end - insert_start);
+        std::cout << "[INFO] " << patterns.size() << " patrones añadidos en "
+                  << duration.count() << " ms\n";
+        std::cout << "[INFO] Total de nodos: " << node_count() << "\n";
     }
-    return cleaned;
 }
 
-std::vector<MatchResult> PatternMatcher::search(const std::string& text,
-                                                size_t context_size) const {
-    auto start_time = HighResClock::now();
-    std::vector<MatchResult> matches;
+bool PatternMatcher::remove_pattern(PatternID id) {
+    check_id(id);
+    if (compaction_ready()) install_compaction();
+    if (removed_[id]) return false;
+    removed_[id] = 1;
+    ++tombstones_;
+    if (!compaction_.valid() &&
+        static_cast<double>(tombstones_) > compaction_threshold_ * patterns_.size()) {
+        start_compaction();
+    }
+    return true;
+}
 
-    const std::string cleaned_text = clean_text(text);
-    std::vector<std::string> lines;
-    split_lines(cleaned_text, lines);
+void PatternMatcher::set_compaction_threshold(double ratio) {
+    if (!(ratio >= 0.0)) {
+        throw std::invalid_argument("El umbral de compactación no puede ser negativo");
+    }
+    compaction_threshold_ = ratio;
+}
 
-    for (size_t line_num = 0; line_num < lines.size(); ++line_num) {
-        const std::string& line = lines[line_num];
-        TrieNode* current_node = root_.get();
+void PatternMatcher::wait_for_compaction() {
+    if (compaction_.valid()) install_compaction();
+}
 
-        for (size_t col = 0; col < line.size(); ++col) {
-            char c = line[col];
-            int idx = char_to_index(c);
-            if (idx == -1) continue;
+bool PatternMatcher::compaction_ready() const {
+    return compaction_.valid() &&
+           compaction_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
 
-            while (current_node != root_.get() && !current_node->children[idx]) {
-                current_node = current_node->failure_link;
-            }
-            if (current_node->children[idx]) {
-                current_node = current_node->children[idx].get();
+void PatternMatcher::start_compaction() {
+    // El hilo trabaja sobre copias: mientras tanto el matcher puede moverse,
+    // seguir buscando o recibir más cambios.
+    compaction_ = std::async(std::launch::async,
+        [patterns = patterns_, normalized = normalized_patterns_, removed = removed_,
+         tombstones = tombstones_, alphabet = automaton_.alphabet]() {
+            Compaction result;
+            result.automaton.alphabet = alphabet;
+            result.tombstones = tombstones;
+            result.patterns.reserve(patterns.size(), patterns.total_bytes());
+            result.normalized.reserve(normalized.size(), normalized.total_bytes());
+            for (PatternID id = 0; id < patterns.size(); ++id) {
+                const bool live = !removed[id];
+                result.patterns.add(live ? patterns[id] : std::string_view());
+                result.normalized.add(live ? normalized[id] : std::string_view());
             }
+            result.automaton.build(result.normalized, result.canonical);
+            return result;
+        });
+}
+
+void PatternMatcher::install_compaction() {
+    auto install_start = HighResClock::now();
+    Compaction result = compaction_.get();
+    // Patrones añadidos mientras se compactaba; los retirados en ese
+    // intervalo siguen en el autómata y conservan su lápida.
+    const PatternID first = result.patterns.size();
+    for (PatternID id = first; id < patterns_.size(); ++id) {
+        result.patterns.add(patterns_[id]);
+        result.normalized.add(normalized_patterns_[id]);
+    }
+    if (first < patterns_.size()) {
+        result.automaton.insert(result.normalized, first, result.canonical);
+    }
+
+    automaton_ = std::move(result.automaton);
+    patterns_ = std::move(result.patterns);
+    normalized_patterns_ = std::move(result.normalized);
+    canonical_ = std::move(result.canonical);
+    link_aliases(0);
+    select_engine();
+    tombstones_ -= result.tombstones;
+
+    if (verbose_) {
+        auto install_end = HighResClock::now();
+        auto duration = std::chrono::duration_cast<TimeDuration>(install_end - install_start);
+        std::cout << "[INFO] Autómata compactado instalado en " << duration.count() << " ms\n";
+        std::cout << "[INFO] Total de nodos: " << node_count() << "\n";
+    }
+}
 
-            if (!current_node->pattern_indices.empty()) {
-                collect_matches(current_node, matches, line_num + 1, col + 1,
-                                line, col, context_size);
+void PatternMatcher::check_id(PatternID id) const {
+    if (id >= patterns_.size()) {
+        throw std::out_of_range("PatternID fuera de rango: " + std::to_string(id));
+    }
+}
+
+bool PatternMatcher::is_removed(PatternID id) const {
+    check_id(id);
+    return removed_[id] != 0;
+}
+
+PatternID PatternMatcher::canonical_id(PatternID id) const {
+    check_id(id);
+    return canonical_[id];
+}
+
+uint8_t PatternMatcher::pattern_flags(PatternID id) const {
+    check_id(id);
+    return flags_[id];
+}
+
+std::vector<PatternID> PatternMatcher::aliases(PatternID id) const {
+    check_id(id);
+    const PatternID canonical = canonical_[id];
+    std::vector<PatternID> group(1, canonical);
+    for (PatternID alias = next_alias_[canonical]; alias != kNoPattern; alias = next_alias_[alias]) {
+        group.push_back(alias);
+    }
+    std::sort(group.begin(), group.end());
+    return group;
+}
+
+void PatternMatcher::link_aliases(PatternID first) {
+    if (first == 0) next_alias_.clear();
+    next_alias_.resize(canonical_.size(), kNoPattern);
+    // Las cadenas van en orden creciente de ID: emitted_id() devuelve el
+    // primer alias que acepta. Los IDs nuevos son mayores que los que ya
+    // están, así que se añaden al final; cada cola se busca una sola vez.
+    std::unordered_map<PatternID, PatternID> tails;
+    for (PatternID id = first; id < canonical_.size(); ++id) {
+        const PatternID canonical = canonical_[id];
+        if (canonical == id) continue;
+        auto [it, inserted] = tails.try_emplace(canonical, canonical);
+        if (inserted) {
+            while (next_alias_[it->second] != kNoPattern) it->second = next_alias_[it->second];
+        }
+        next_alias_[it->second] = id;
+        it->second = id;
+    }
+}
+
+PatternID PatternMatcher::emitted_id(PatternID canonical, const char* text,
+                                     bool word_before, bool word_after) const {
+    if (accepts(canonical, text, word_before, word_after)) return canonical;
+    for (PatternID alias = next_alias_[canonical]; alias != kNoPattern; alias = next_alias_[alias]) {
+        if (accepts(alias, text, word_before, word_after)) return alias;
+    }
+    return kNoPattern;
+}
+
+void PatternMatcher::set_engine(Engine engine) {
+    const Engine previous = requested_engine_;
+    requested_engine_ = engine;
+    try {
+        if (!patterns_.empty()) select_engine();
+    } catch (...) {
+        requested_engine_ = previous;
+        throw;
+    }
+}
+
+void PatternMatcher::select_engine() {
+    // Los motores alternativos solo ven un patrón por cadena normalizada, el
+    // canónico; emitted_id() se encarga de los alias y los retirados.
+    DictionaryProfile profile;
+    for (PatternID id = 0; id < normalized_patterns_.size(); ++id) {
+        if (canonical_[id] == id && !normalized_patterns_[id].empty()) {
+            profile.add(normalized_patterns_[id]);
+        }
+    }
+    const Engine engine = requested_engine_ == Engine::Auto ? choose_engine(profile) :
+                                                             requested_engine_;
+    if (engine == Engine::AhoCorasick) {
+        engine_ = engine;
+        line_searcher_.reset();
+        return;
+    }
+
+    std::vector<EngineKey> keys;
+    keys.reserve(profile.count);
+    for (PatternID id = 0; id < normalized_patterns_.size(); ++id) {
+        std::string_view pattern = normalized_patterns_[id];
+        if (canonical_[id] != id || pattern.empty()) continue;
+        std::string folded(pattern);
+        for (char& c : folded) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        keys.push_back({std::move(folded), id});
+    }
+    line_searcher_ = make_line_searcher(engine, keys);
+    engine_ = engine;
+    if (verbose_) {
+        std::cout << "[INFO] Motor de búsqueda: " << engine_name(engine_) << "\n";
+    }
+}
+
+void PatternMatcher::scan_line(std::string_view line, std::string& folded,
+                               const LineSearcher::Emit& emit) const {
+    // El autómata no distingue mayúsculas en sus transiciones; los motores
+    // alternativos deben ver lo mismo.
+    if (raw_bytes() || case_sensitive_ || match_case_count_ > 0) {
+        folded.assign(line);
+        for (char& c : folded) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        line = folded;
+    }
+    line_searcher_->scan(line, emit);
+}
+
+void PatternMatcher::search_lines(std::string_view text, size_t context_size,
+                                  std::vector<MatchResult>& matches) const {
+    std::string cleaned;
+    std::string folded;
+    std::vector<size_t> offsets; // byte de origen de cada carácter de cleaned
+    const std::array<char, 256>& table = text_table();
+    const bool raw = raw_bytes();
+    std::string_view line;
+    size_t line_num = 1;
+    size_t line_start = 0;
+    size_t line_end = 0;
+    auto emit = [&](size_t pos, PatternID canonical) {
+        // Mismos cálculos que el Scanner, con la longitud normalizada.
+        const size_t length = normalized_patterns_[canonical].size();
+        const size_t start = pos + 1 - length;
+        // Los límites se miran en los bytes originales, que aquí están a mano.
+        const size_t first = raw ? line_start + start : offsets[start];
+        const size_t last = raw ? line_start + pos : offsets[pos];
+        const bool word_before = first > line_start && is_word_byte(text[first - 1]);
+        const bool word_after = last + 1 < line_end && is_word_byte(text[last + 1]);
+        const PatternID pattern_idx = emitted_id(canonical, line.data() + start,
+                                                 word_before, word_after);
+        if (pattern_idx == kNoPattern) return;
+        const size_t context_start = (pos + 1 > length) ? pos - length : 0;
+        const size_t context_end = std::min(pos + context_size, line.size());
+        matches.push_back({line_num,
+                           start + 1,
+                           std::string(patterns_[pattern_idx]),
+                           make_context(line, context_start, context_end, fold_context()),
+                           pattern_idx,
+                           first,
+                           last + 1 - first});
+    };
+    while (line_start < text.size()) {
+        line_end = text.find('\n', line_start);
+        if (line_end == std::string_view::npos) line_end = text.size();
+        if (raw) {
+            // Con bytes crudos no hay nada que limpiar: la línea va tal cual.
+            line = text.substr(line_start, line_end - line_start);
+        } else {
+            cleaned.clear();
+            offsets.clear();
+            for (size_t i = line_start; i < line_end; ++i) {
+                if (char n = table[static_cast<unsigned char>(text[i])]) {
+                    cleaned += n;
+                    offsets.push_back(i);
+                }
             }
+            line = cleaned;
+        }
+        scan_line(line, folded, emit);
+        line_start = line_end + 1;
+        ++line_num;
+    }
+}
+
+std::string PatternMatcher::clean_text(std::string_view text) const {
+    std::string cleaned;
+    cleaned.reserve(text.size());
+    clean_into(text, cleaned, text_table());
+    return cleaned;
+}
+
+void PatternMatcher::clean_into(std::string_view text, std::string& cleaned,
+                                const std::array<char, 256>& table) const {
+    if (raw_bytes()) {
+        cleaned.append(text);
+        return;
+    }
+    for (unsigned char c : text) {
+        if (char n = table[c]) cleaned += n;
+    }
+}
+
+std::vector<MatchResult> PatternMatcher::search(std::string_view text,
+                                                size_t context_size) const {
+    auto start_time = HighResClock::now();
+    std::vector<MatchResult> matches;
+
+    if (line_searcher_) {
+        search_lines(text, context_size, matches);
+    } else {
+        Scanner scanner(*this, context_size);
+        scanner.feed(text);
+        scanner.finish();
+        MatchResult match;
+        while (scanner.next(match)) {
+            matches.push_back(std::move(match));
         }
     }
 
@@ -105,93 +557,486 @@ std::vector<MatchResult> PatternMatcher::search(const std::string& text,
     return matches;
 }
 
-const std::vector<std::string>& PatternMatcher::patterns() const { return patterns_; }
-int PatternMatcher::node_count() const { return node_count_; }
-int PatternMatcher::max_depth() const { return max_depth_; }
+void PatternMatcher::save(const std::string& path) const {
+    if (patterns_.empty()) {
+        throw std::logic_error("No hay un autómata construido para guardar");
+    }
+    const Automaton& automaton = automaton_;
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+    header.version = kSnapshotVersion;
+    header.byte_order = kByteOrderMark;
+    header.alphabet_size = automaton.stride;
+    header.flags = (case_sensitive_ ? kCaseSensitiveFlag : 0) | (raw_bytes() ? kRawBytesFlag : 0);
+    header.state_count = automaton.state_count();
+    header.output_count = automaton.outputs.size();
+    header.pattern_count = patterns_.size();
+    header.pattern_bytes = patterns_.total_bytes();
+    header.normalized_bytes = normalized_patterns_.total_bytes();
+    header.max_depth = automaton.max_depth;
+    std::memcpy(header.normalization, normalized_.data(), sizeof header.normalization);
+    const SnapshotLayout layout = snapshot_layout(header);
+    header.file_size = layout.end;
 
-void PatternMatcher::split_lines(const std::string& text, std::vector<std::string>& lines) const {
-    std::stringstream ss(text);
-    std::string line;
-    while (std::getline(ss, line)) {
-        lines.push_back(line);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("No se pudo crear el archivo: " + path);
+    }
+    size_t pos = 0;
+    write_section(out, pos, 0, &header, sizeof header);
+    write_section(out, pos, layout.transitions, automaton.transitions.data(),
+                  automaton.transitions.size() * sizeof(StateID));
+    write_section(out, pos, layout.fail, automaton.fail.data(),
+                  automaton.fail.size() * sizeof(StateID));
+    write_section(out, pos, layout.output_link, automaton.output_link.data(),
+                  automaton.output_link.size() * sizeof(StateID));
+    write_section(out, pos, layout.depth, automaton.depth.data(),
+                  automaton.depth.size() * sizeof(uint32_t));
+    write_section(out, pos, layout.out_head, automaton.out_head.data(),
+                  automaton.out_head.size() * sizeof(uint32_t));
+    write_section(out, pos, layout.outputs, automaton.outputs.data(),
+                  automaton.outputs.size() * sizeof(Automaton::Output));
+    write_offsets(out, pos, layout.pattern_offsets, patterns_);
+    write_section(out, pos, layout.pattern_bytes, patterns_.bytes().data(),
+                  patterns_.total_bytes());
+    write_offsets(out, pos, layout.normalized_offsets, normalized_patterns_);
+    write_section(out, pos, layout.normalized_bytes, normalized_patterns_.bytes().data(),
+                  normalized_patterns_.total_bytes());
+    const std::vector<uint32_t> canonical(canonical_.begin(), canonical_.end());
+    write_section(out, pos, layout.canonical, canonical.data(),
+                  canonical.size() * sizeof(uint32_t));
+    write_section(out, pos, layout.removed, removed_.data(), removed_.size());
+    write_section(out, pos, layout.flags, flags_.data(), flags_.size());
+    write_section(out, pos, layout.byte_class, automaton.byte_class.data(),
+                  automaton.byte_class.size());
+    write_section(out, pos, layout.end, nullptr, 0);
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Error al escribir el archivo: " + path);
     }
 }
 
-void PatternMatcher::collect_matches(TrieNode* node, std::vector<MatchResult>& matches,
-                                     size_t line, size_t column,
-                                     const std::string& line_text, size_t pos,
-                                     size_t context_size) const {
-    for (TrieNode* temp = node; temp != nullptr; temp = temp->output_link) {
-        for (PatternID pattern_idx : temp->pattern_indices) {
-            const std::string& pattern = patterns_[pattern_idx];
-            size_t start = (pos + 1 > pattern.length()) ?
-                            std::min(pos - pattern.length(), line_text.length()) : 0;
-            size_t end = std::min(pos + context_size, line_text.length());
-            std::string context = line_text.substr(start, end - start);
-            context.erase(std::unique(context.begin(), context.end(),
-                                     [](char a, char b){return a==' ' && b==' ';}),
-                          context.end());
-            matches.push_back({line,
-                               column - pattern.length() + 1,
-                               pattern,
-                               context,
-                               pattern_idx});
-        }
-    }
-}
-
-void PatternMatcher::clear_trie() {
-    root_.reset(new TrieNode());
-    node_count_ = 1;
-    max_depth_ = 0;
-}
-
-void PatternMatcher::build_trie() {
-    for (PatternID i = 0; i < patterns_.size(); ++i) {
-        std::string pattern = clean_text(patterns_[i]);
-        if (pattern.empty()) continue;
-
-        TrieNode* node = root_.get();
-        for (char c : pattern) {
-            int idx = char_to_index(c);
-            if (!node->children[idx]) {
-                node->children[idx].reset(new TrieNode());
-                node->children[idx]->depth = node->depth + 1;
-                max_depth_ = std::max(max_depth_, static_cast<int>(node->children[idx]->depth));
-                node_count_++;
+PatternMatcher PatternMatcher::load(const std::string& path, bool verbose) {
+    auto load_start = HighResClock::now();
+    auto file = std::make_shared<MappedFile>(path);
+    const std::string_view data = file->view();
+
+    SnapshotHeader header;
+    if (data.size() < sizeof header) throw corrupt_snapshot(path);
+    std::memcpy(&header, data.data(), sizeof header);
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof header.magic) != 0) {
+        throw std::runtime_error("El archivo no es una instantánea del autómata: " + path);
+    }
+    if (header.version == 0 || header.version > kSnapshotVersion) {
+        throw std::runtime_error("Versión de instantánea no soportada (" +
+                                 std::to_string(header.version) + "): " + path);
+    }
+    // Antes de la versión 4 solo existía el alfabeto de letras.
+    const bool raw = header.version >= 4 && (header.flags & kRawBytesFlag);
+    if (header.byte_order != kByteOrderMark ||
+        (!raw && header.alphabet_size != ALPHABET_SIZE)) {
+        throw std::runtime_error("Instantánea generada para otra plataforma: " + path);
+    }
+    // Cotas previas para que el cálculo de la disposición no desborde.
+    if (header.file_size != data.size() || header.state_count == 0 ||
+        header.state_count > data.size() || header.output_count > data.size() ||
+        header.pattern_count == 0 || header.pattern_count > data.size() ||
+        header.pattern_bytes > data.size() || header.normalized_bytes > data.size() ||
+        header.max_depth > UINT32_MAX || header.alphabet_size == 0 ||
+        header.alphabet_size >= kNoClass ||
+        reinterpret_cast<uintptr_t>(data.data()) % alignof(uint64_t) != 0) {
+        throw corrupt_snapshot(path);
+    }
+    const SnapshotLayout layout = snapshot_layout(header);
+    if (layout.end != data.size()) throw corrupt_snapshot(path);
+
+    PatternMatcher matcher(verbose, (header.flags & kCaseSensitiveFlag) != 0);
+    if (raw) {
+        matcher.automaton_.alphabet = Alphabet::Bytes;
+        matcher.build_normalization();
+    }
+    if (std::memcmp(header.normalization, matcher.normalized_.data(),
+                    sizeof header.normalization) != 0) {
+        throw std::runtime_error("La normalización de la instantánea no coincide con esta versión: " +
+                                 path);
+    }
+
+    const size_t states = header.state_count;
+    Automaton& automaton = matcher.automaton_;
+    automaton.stride = header.alphabet_size;
+    if (header.version >= 4) {
+        std::memcpy(automaton.byte_class.data(), data.data() + layout.byte_class,
+                    automaton.byte_class.size());
+    }
+    automaton.transitions.view(section_data<StateID>(data, layout.transitions),
+                               states * automaton.stride);
+    automaton.fail.view(section_data<StateID>(data, layout.fail), states);
+    automaton.output_link.view(section_data<StateID>(data, layout.output_link), states);
+    automaton.depth.view(section_data<uint32_t>(data, layout.depth), states);
+    automaton.out_head.view(section_data<uint32_t>(data, layout.out_head), states);
+    automaton.outputs.view(section_data<Automaton::Output>(data, layout.outputs),
+                           header.output_count);
+    automaton.max_depth = static_cast<uint32_t>(header.max_depth);
+    automaton.storage = file;
+
+    // Los patrones sí se copian: PatternPool es dueño de su bloque (crece con
+    // add_patterns() y patterns() lo expone tal cual), ocupan poco al lado de
+    // las tablas y la copia valida los desplazamientos de una pasada.
+    const size_t count = header.pattern_count;
+    try {
+        matcher.patterns_ = PatternPool::from_parts(
+            data.substr(layout.pattern_bytes, header.pattern_bytes),
+            section_data<uint64_t>(data, layout.pattern_offsets), count);
+        matcher.normalized_patterns_ = PatternPool::from_parts(
+            data.substr(layout.normalized_bytes, header.normalized_bytes),
+            section_data<uint64_t>(data, layout.normalized_offsets), count);
+    } catch (const std::runtime_error&) {
+        throw corrupt_snapshot(path);
+    }
+    automaton.validate(count);
+
+    matcher.canonical_.resize(count);
+    matcher.removed_.assign(count, 0);
+    matcher.flags_.assign(count, 0);
+    if (header.version >= 3) {
+        const uint8_t* flags = section_data<uint8_t>(data, layout.flags);
+        for (PatternID id = 0; id < count; ++id) {
+            if (flags[id] & ~kKnownPatternFlags) throw corrupt_snapshot(path);
+            matcher.flags_[id] = flags[id];
+            matcher.update_flag_counts(flags[id], 1);
+        }
+    }
+    if (header.version >= 2) {
+        const uint32_t* canonical = section_data<uint32_t>(data, layout.canonical);
+        const uint8_t* removed = section_data<uint8_t>(data, layout.removed);
+        for (PatternID id = 0; id < count; ++id) {
+            if (canonical[id] > id || canonical[canonical[id]] != canonical[id] || removed[id] > 1) {
+                throw corrupt_snapshot(path);
             }
-            node = node->children[idx].get();
+            matcher.canonical_[id] = canonical[id];
+            matcher.removed_[id] = removed[id];
+            matcher.tombstones_ += removed[id];
         }
-        node->is_end_of_word = true;
-        node->pattern_indices.push_back(i);
+    } else {
+        for (PatternID id = 0; id < count; ++id) matcher.canonical_[id] = id;
+    }
+    matcher.link_aliases(0);
+    matcher.select_engine();
+
+    if (verbose) {
+        auto load_end = HighResClock::now();
+        auto duration = std::chrono::duration_cast<TimeDuration>(load_end - load_start);
+        std::cout << "[INFO] Autómata cargado en " << duration.count() << " ms\n";
+        std::cout << "[INFO] Total de nodos: " << matcher.node_count() << "\n";
     }
+    return matcher;
 }
 
-void PatternMatcher::build_failure_links() {
-    std::queue<TrieNode*> node_queue;
-    root_->failure_link = root_.get();
-    for (int i = 0; i < ALPHABET_SIZE; ++i) {
-        if (root_->children[i]) {
-            root_->children[i]->failure_link = root_.get();
-            node_queue.push(root_->children[i].get());
+const PatternPool& PatternMatcher::patterns() const { return patterns_; }
+int PatternMatcher::node_count() const { return static_cast<int>(automaton_.state_count()); }
+int PatternMatcher::max_depth() const { return static_cast<int>(automaton_.max_depth); }
+
+void PatternMatcher::scan_cleaned(std::string_view cleaned, size_t first_line,
+                                  size_t context_size,
+                                  std::vector<MatchResult>& matches,
+                                  const uint8_t* neighbors) const {
+    std::vector<uint8_t> derived;
+    if (!uses_word_boundaries()) {
+        neighbors = nullptr;
+    } else if (!neighbors) {
+        derived.resize(cleaned.size());
+        for (size_t i = 0; i < cleaned.size(); ++i) {
+            if (i > 0 && is_word_byte(cleaned[i - 1])) derived[i] |= kWordBefore;
+            if (i + 1 < cleaned.size() && is_word_byte(cleaned[i + 1])) derived[i] |= kWordAfter;
+        }
+        neighbors = derived.data();
+    }
+    if (line_searcher_) {
+        std::string folded;
+        size_t line_num = first_line;
+        size_t line_start = 0;
+        while (line_start < cleaned.size()) {
+            size_t line_end = cleaned.find('\n', line_start);
+            if (line_end == std::string_view::npos) line_end = cleaned.size();
+            std::string_view line = cleaned.substr(line_start, line_end - line_start);
+            scan_line(line, folded, [&](size_t pos, PatternID canonical) {
+                const size_t length = normalized_patterns_[canonical].size();
+                push_match(matches, canonical, length, line_num, pos + 1, line,
+                           line_start, pos, context_size, neighbors);
+            });
+            line_start = line_end + 1;
+            ++line_num;
         }
+        return;
     }
-    while (!node_queue.empty()) {
-        TrieNode* current = node_queue.front();
-        node_queue.pop();
-        for (int i = 0; i < ALPHABET_SIZE; ++i) {
-            if (!current->children[i]) continue;
-            TrieNode* child = current->children[i].get();
-            node_queue.push(child);
-            TrieNode* failure = current->failure_link;
-            while (failure != root_.get() && !failure->children[i]) {
-                failure = failure->failure_link;
+    std::unique_ptr<TransitionCache> transitions;
+    if (lazy_dfa_rows_ > 0) {
+        transitions = std::make_unique<TransitionCache>(automaton_, lazy_dfa_rows_);
+    }
+    size_t line_num = first_line;
+    size_t line_start = 0;
+    while (line_start < cleaned.size()) {
+        size_t line_end = cleaned.find('\n', line_start);
+        if (line_end == std::string_view::npos) line_end = cleaned.size();
+        std::string_view line = cleaned.substr(line_start, line_end - line_start);
+        StateID state = kRootState;
+
+        for (size_t col = 0; col < line.size(); ++col) {
+            const uint8_t idx = automaton_.byte_class[static_cast<unsigned char>(line[col])];
+            if (idx == kNoClass) continue;
+
+            state = transitions ? transitions->step(state, idx) : automaton_.step(state, idx);
+
+            if (automaton_.has_output(state)) {
+                collect_matches(state, matches, line_num, col + 1,
+                                line, line_start, col, context_size, neighbors);
             }
-            child->failure_link = failure->children[i] ? failure->children[i].get() : root_.get();
-            child->output_link = child->failure_link->pattern_indices.empty() ?
-                                  child->failure_link->output_link : child->failure_link;
         }
+        line_start = line_end + 1;
+        ++line_num;
     }
 }
 
+void PatternMatcher::collect_matches(StateID state, std::vector<MatchResult>& matches,
+                                     size_t line, size_t column,
+                                     std::string_view line_text, size_t line_offset,
+                                     size_t pos, size_t context_size,
+                                     const uint8_t* neighbors) const {
+    for (StateID temp = state; temp != kRootState; temp = automaton_.output_link[temp]) {
+        // La longitud que cuenta es la del patrón normalizado (la
+        // profundidad del estado), no la del original.
+        const size_t length = automaton_.depth[temp];
+        for (uint32_t out = automaton_.out_head[temp]; out != kNoOutput;
+             out = automaton_.outputs[out].next) {
+            push_match(matches, automaton_.outputs[out].pattern, length, line, column,
+                       line_text, line_offset, pos, context_size, neighbors);
+        }
+    }
+}
+
+void PatternMatcher::push_match(std::vector<MatchResult>& matches, PatternID canonical,
+                                size_t length, size_t line, size_t column,
+                                std::string_view line_text, size_t line_offset,
+                                size_t pos, size_t context_size,
+                                const uint8_t* neighbors) const {
+    const bool word_before = neighbors && (neighbors[line_offset + pos + 1 - length] & kWordBefore);
+    const bool word_after = neighbors && (neighbors[line_offset + pos] & kWordAfter);
+    const PatternID pattern_idx = emitted_id(canonical, line_text.data() + pos + 1 - length,
+                                             word_before, word_after);
+    if (pattern_idx == kNoPattern) return;
+    std::string_view pattern = patterns_[pattern_idx];
+    size_t start = (pos + 1 > length) ?
+                    std::min(pos - length, line_text.length()) : 0;
+    size_t end = std::min(pos + context_size, line_text.length());
+    matches.push_back({line,
+                       column - length + 1,
+                       std::string(pattern),
+                       make_context(line_text, start, end, fold_context()),
+                       pattern_idx,
+                       line_offset + pos + 1 - length,
+                       length});
+}
+
+std::string PatternMatcher::make_context(std::string_view line_text, size_t start, size_t end,
+                                        bool fold) {
+    std::string context(line_text.substr(start, end - start));
+    if (fold) {
+        for (char& c : context) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    context.erase(std::unique(context.begin(), context.end(),
+                             [](char a, char b){return a==' ' && b==' ';}),
+                  context.end());
+    return context;
+}
+
+void PatternMatcher::normalize_patterns() {
+    // Por debajo de este tamaño no compensa repartir el trabajo entre hilos.
+    constexpr size_t kPatternsPerThread = 1 << 16;
+    const size_t count = patterns_.size();
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(
+        std::thread::hardware_concurrency(), count / kPatternsPerThread));
+
+    std::vector<PatternPool> parts(workers);
+    auto normalize_range = [&](size_t part) {
+        const size_t begin = count * part / workers;
+        const size_t end = count * (part + 1) / workers;
+        PatternPool& out = parts[part];
+        std::string cleaned;
+        for (size_t i = begin; i < end; ++i) {
+            cleaned.clear();
+            clean_into(patterns_[i], cleaned, normalized_);
+            out.add(cleaned);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t part = 1; part < workers; ++part) {
+        threads.emplace_back(normalize_range, part);
+    }
+    normalize_range(0);
+    for (auto& thread : threads) thread.join();
+
+    normalized_patterns_ = std::move(parts[0]);
+    for (size_t part = 1; part < workers; ++part) {
+        normalized_patterns_.append(parts[part]);
+    }
+}
+
+Scanner::Scanner(const PatternMatcher& matcher, size_t context_size)
+    : matcher_(matcher), context_size_(context_size) {
+    if (matcher.lazy_dfa_rows_ > 0) {
+        transitions_ = std::make_unique<TransitionCache>(matcher.automaton_,
+                                                         matcher.lazy_dfa_rows_);
+    }
+}
+
+void Scanner::feed(std::string_view chunk) {
+    if (chunk_pos_ < chunk_.size()) {
+        throw std::logic_error("El fragmento anterior no se ha consumido por completo");
+    }
+    if (finishing_) {
+        throw std::logic_error("No se puede alimentar un escáner finalizado");
+    }
+    chunk_ = chunk;
+    chunk_pos_ = 0;
+}
+
+void Scanner::feed(std::string_view chunk, const Sink& sink) {
+    feed(chunk);
+    MatchResult match;
+    while (next(match)) sink(match);
+}
+
+void Scanner::finish() {
+    finishing_ = true;
+}
+
+void Scanner::finish(const Sink& sink) {
+    finish();
+    MatchResult match;
+    while (next(match)) sink(match);
+}
+
+bool Scanner::next(MatchResult& match) {
+    while (ready_.empty()) {
+        if (chunk_pos_ < chunk_.size()) {
+            consume(static_cast<unsigned char>(chunk_[chunk_pos_++]));
+        } else if (finishing_ && (column_ > 0 || !pending_.empty())) {
+            end_line();
+        } else {
+            return false;
+        }
+    }
+    match = std::move(ready_.front());
+    ready_.pop_front();
+    return true;
+}
+
+void Scanner::consume(unsigned char c) {
+    const size_t byte_offset = offset_++;
+    const bool word = matcher_.is_word_byte(c);
+    if (deferred_state_ != kRootState) {
+        // El límite derecho depende de este byte, aunque la normalización lo descarte.
+        emit_outputs(deferred_state_, deferred_pos_, deferred_offset_, word);
+        deferred_state_ = kRootState;
+    }
+    if (c == '\n') {
+        end_line();
+        return;
+    }
+    const bool word_before = last_word_;
+    last_word_ = word;
+    const Automaton& automaton = matcher_.automaton_;
+    // Con bytes crudos la clase sale del propio byte y no se descarta nada.
+    const char cleaned = matcher_.raw_bytes() ? static_cast<char>(c) : matcher_.normalize_byte(c);
+    if (cleaned == '\0' && !matcher_.raw_bytes()) return;
+
+    const size_t pos = column_++;
+    window_ += cleaned;
+    window_offsets_.push_back(byte_offset);
+    window_word_before_.push_back(word_before);
+    const int idx = automaton.byte_class[static_cast<unsigned char>(cleaned)];
+    state_ = transitions_ ? transitions_->step(state_, idx) : automaton.step(state_, idx);
+    if (automaton.has_output(state_)) {
+        if (matcher_.uses_word_boundaries()) {
+            deferred_state_ = state_;
+            deferred_pos_ = pos;
+            deferred_offset_ = byte_offset;
+        } else {
+            emit_outputs(state_, pos, byte_offset, false);
+        }
+    }
+    while (!pending_.empty() && pending_.front().pos + context_size_ <= column_) {
+        release(pending_.front());
+        pending_.pop_front();
+    }
+    trim_window();
+}
+
+void Scanner::emit_outputs(StateID state, size_t pos, size_t byte_offset, bool word_after) {
+    const Automaton& automaton = matcher_.automaton_;
+    for (StateID temp = state; temp != kRootState; temp = automaton.output_link[temp]) {
+        const size_t length = automaton.depth[temp];
+        const size_t idx = pos + 1 - length - window_start_;
+        const size_t start_offset = window_offsets_[idx];
+        const size_t context_start = (pos + 1 > length) ? pos - length : 0;
+        for (uint32_t out = automaton.out_head[temp]; out != kNoOutput;
+             out = automaton.outputs[out].next) {
+            const PatternID pattern_idx = matcher_.emitted_id(
+                automaton.outputs[out].pattern, window_.data() + idx,
+                window_word_before_[idx] != 0, word_after);
+            if (pattern_idx == PatternMatcher::kNoPattern) continue;
+            pending_.push_back({pos, pos + 2 - length, context_start, start_offset,
+                                byte_offset + 1 - start_offset, pattern_idx});
+        }
+    }
+}
+
+void Scanner::end_line() {
+    if (deferred_state_ != kRootState) {
+        emit_outputs(deferred_state_, deferred_pos_, deferred_offset_, false);
+        deferred_state_ = kRootState;
+    }
+    for (const auto& pending : pending_) {
+        release(pending);
+    }
+    pending_.clear();
+    window_.clear();
+    window_offsets_.clear();
+    window_word_before_.clear();
+    last_word_ = false;
+    window_start_ = 0;
+    column_ = 0;
+    state_ = kRootState;
+    ++line_;
+}
+
+void Scanner::release(const Pending& pending) {
+    std::string_view pattern = matcher_.patterns_[pending.pattern_id];
+    size_t start = std::max(pending.context_start, window_start_);
+    size_t end = std::min(pending.pos + context_size_, column_);
+    ready_.push_back({line_,
+                      pending.column,
+                      std::string(pattern),
+                      PatternMatcher::make_context(window_, start - window_start_,
+                                                   end - window_start_,
+                                                   matcher_.fold_context()),
+                      pending.pattern_id,
+                      pending.offset,
+                      pending.length});
+}
+
+void Scanner::trim_window() {
+    // Las coincidencias futuras no miran más atrás que el patrón más largo.
+    const size_t longest = matcher_.automaton_.max_depth;
+    size_t keep_from = column_ > longest + 1 ? column_ - longest - 1 : 0;
+    if (!pending_.empty()) keep_from = std::min(keep_from, pending_.front().context_start);
+    const size_t drop = keep_from > window_start_ ? keep_from - window_start_ : 0;
+    if (drop < 4096 || drop < window_.size() / 2) return;
+    window_.erase(0, drop);
+    window_offsets_.erase(window_offsets_.begin(), window_offsets_.begin() + drop);
+    window_word_before_.erase(window_word_before_.begin(), window_word_before_.begin() + drop);
+    window_start_ += drop;
+}
+
 } // namespace ahocorasick
@@ -1,21 +1,24 @@
 #ifndef PATTERN_MATCHER_H
 #define PATTERN_MATCHER_H
 
+#include "Automaton.h"
+#include "PatternPool.h"
+#include "SearchEngine.h"
+
 #include <array>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
-#include <queue>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ahocorasick {
 
-static constexpr int ALPHABET_SIZE = 28; // 26 letras + espacio + guión
 using TimeDuration = std::chrono::milliseconds;
 using HighResClock = std::chrono::high_resolution_clock;
-using PatternID = size_t;
-
-int char_to_index(char c);
 
 struct MatchResult {
     size_t line;
@@ -23,53 +26,282 @@ struct MatchResult {
     std::string pattern;
     std::string context;
     PatternID pattern_id;
+    size_t offset = 0; // byte del texto original donde empieza la coincidencia
+    size_t length = 0; // bytes del texto original que abarca (incluye los descartados)
 
     bool operator<(const MatchResult& other) const;
 };
 
+// Opciones de cada patrón. Se comprueban al emitir cada coincidencia, así
+// que cambiarlas no reconstruye el autómata.
+enum PatternFlag : uint8_t {
+    kMatchCase = 1, // distingue mayúsculas aunque el matcher no lo haga
+    // Límites de palabra, según los bytes originales vecinos (ver
+    // is_word_byte()): la coincidencia no puede ir precedida o seguida de
+    // un byte de palabra.
+    kWordStart = 2,
+    kWordEnd = 4,
+    kWholeWord = kWordStart | kWordEnd,
+};
+
+// Para scan_cleaned(): clase del byte original inmediatamente anterior y
+// posterior a cada carácter normalizado.
+enum NeighborBit : uint8_t {
+    kWordBefore = 1,
+    kWordAfter = 2,
+};
+
 class PatternMatcher {
 public:
     explicit PatternMatcher(bool verbose = false, bool case_sensitive = false);
 
+    // Opciones de búsqueda: se cambian en cualquier momento y sin coste.
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    bool verbose() const { return verbose_; }
+    // Con true todos los patrones distinguen mayúsculas. Es una opción de
+    // construcción, pero el autómata no depende de ella (sus transiciones
+    // ya pliegan mayúsculas y el caso exacto se comprueba al emitir): solo
+    // se rehacen la tabla de normalización y los patrones normalizados.
+    void set_case_sensitive(bool case_sensitive);
+    bool case_sensitive() const { return case_sensitive_; }
+    // Con Alphabet::Bytes el autómata recorre el texto original sin pasada
+    // de limpieza: no se descarta ningún byte (dígitos, puntuación y UTF-8
+    // cuentan), plegar mayúsculas va en su tabla de clases y column, offset,
+    // length y el contexto se refieren a los bytes del texto tal cual.
+    // clean_text() lo devuelve sin cambios. Reconstruye el autómata.
+    void set_alphabet(Alphabet alphabet);
+    Alphabet alphabet() const { return automaton_.alphabet; }
+
     void initialize(const std::vector<std::string>& patterns);
-    std::string clean_text(const std::string& text) const;
-    std::vector<MatchResult> search(const std::string& text,
+    // Vacía el vector a medida que pasa los patrones al bloque contiguo.
+    void initialize(std::vector<std::string>&& patterns);
+    void initialize(const PatternPool& patterns);
+    // Toma posesión del bloque de patrones sin copiarlo.
+    void initialize(PatternPool&& patterns);
+    // Añade patrones al autómata existente sin reconstruirlo; los nuevos
+    // reciben los PatternID siguientes a los actuales. No debe llamarse
+    // mientras otro hilo busca con este matcher.
+    void add_patterns(const std::vector<std::string>& patterns);
+    void add_patterns(const PatternPool& patterns);
+    // Retira un patrón: deja de emitirse al instante y su hueco en el
+    // autómata se recupera al compactar. Devuelve false si ya lo estaba.
+    // Mismas restricciones de hilos que add_patterns().
+    bool remove_pattern(PatternID id);
+    bool is_removed(PatternID id) const;
+    // Los patrones cuya forma normalizada coincide (duplicados, o que solo
+    // difieren en caracteres que clean_text() descarta o en mayúsculas) se
+    // agrupan bajo el primero, el canónico, y cada coincidencia se emite una
+    // sola vez con su ID (o con el primer alias vivo si se retiró).
+    PatternID canonical_id(PatternID id) const;
+    // Combinación de PatternFlag (0 por defecto). Mismas restricciones de
+    // hilos que add_patterns().
+    void set_pattern_flags(PatternID id, uint8_t flags);
+    uint8_t pattern_flags(PatternID id) const;
+    // IDs originales del grupo de id, en orden creciente. Todos los accesos
+    // por PatternID lanzan std::out_of_range si id no existe.
+    std::vector<PatternID> aliases(PatternID id) const;
+    // Cuando los patrones retirados que siguen en el autómata superan esta
+    // fracción, se reconstruye en segundo plano un autómata denso sin ellos.
+    // Se instala en la siguiente operación de escritura o con
+    // wait_for_compaction(); los PatternID no cambian y el texto de los
+    // patrones retirados queda vacío.
+    void set_compaction_threshold(double ratio);
+    bool compaction_pending() const { return compaction_.valid(); }
+    void wait_for_compaction();
+    // Motor con el que search() y scan_cleaned() recorren el texto (Scanner
+    // y los modos por bloques usan siempre el autómata). Con Engine::Auto,
+    // el valor por defecto, se elige según la forma del diccionario cada vez
+    // que cambian los patrones; engine() dice cuál se está usando.
+    void set_engine(Engine engine);
+    Engine engine() const { return engine_; }
+    // Con max_rows > 0 cada búsqueda usa un DFA perezoso (TransitionCache)
+    // de hasta max_rows filas en lugar de recorrer los enlaces de fallo;
+    // compensa con diccionarios grandes. 0 lo desactiva (por defecto).
+    void set_lazy_dfa(size_t max_rows) { lazy_dfa_rows_ = max_rows; }
+    size_t lazy_dfa_rows() const { return lazy_dfa_rows_; }
+    // Normaliza el texto como lo necesita la búsqueda: conserva las
+    // mayúsculas si el matcher o algún patrón las distingue.
+    std::string clean_text(std::string_view text) const;
+    // Carácter normalizado de un byte según clean_text(), o '\0' si se descarta
+    // (solo tiene sentido con Alphabet::Letters).
+    char normalize_byte(unsigned char c) const { return text_table()[c]; }
+    // Bytes de palabra: letras, dígitos, '_' y bytes no ASCII (UTF-8).
+    bool is_word_byte(unsigned char c) const { return word_byte_[c]; }
+    // Si algún patrón tiene límites de palabra (y scan_cleaned() los
+    // comprobará mejor con la clase de los bytes descartados).
+    bool uses_word_boundaries() const { return word_flag_count_ > 0; }
+    // Recorre el texto con un Scanner sin copiarlo: admite vistas sobre
+    // archivos proyectados en memoria (ver MappedFile).
+    std::vector<MatchResult> search(std::string_view text,
                                     size_t context_size = 20) const;
+    // Busca sobre texto ya normalizado con clean_text(); first_line es el
+    // número de la primera línea del bloque y offset y length se miden en
+    // cleaned. neighbors (un NeighborBit por carácter de cleaned) da la
+    // clase de los bytes originales vecinos para los límites de palabra; sin
+    // él se usan los caracteres vecinos de cleaned, que no ven los
+    // descartados.
+    void scan_cleaned(std::string_view cleaned, size_t first_line,
+                      size_t context_size, std::vector<MatchResult>& matches,
+                      const uint8_t* neighbors = nullptr) const;
+
+    // Vuelca el autómata compilado, los patrones y la normalización a un
+    // archivo binario versionado. load() lo proyecta en memoria y valida los
+    // índices sin reconstruir nada; las tablas se leen directamente del mapa.
+    void save(const std::string& path) const;
+    static PatternMatcher load(const std::string& path, bool verbose = false);
 
-    const std::vector<std::string>& patterns() const;
+    const PatternPool& patterns() const;
     int node_count() const;
     int max_depth() const;
 
 private:
-    struct TrieNode;
-    std::unique_ptr<TrieNode> root_;
-    std::vector<std::string> patterns_;
+    friend class Scanner;
+    // Resultado de una compactación en segundo plano.
+    struct Compaction {
+        Automaton automaton;
+        PatternPool patterns;
+        PatternPool normalized;
+        std::vector<PatternID> canonical;
+        size_t tombstones = 0; // retirados que ya no están en el autómata
+    };
+
+    Automaton automaton_;
+    PatternPool patterns_;
+    PatternPool normalized_patterns_;
     bool verbose_;
     bool case_sensitive_;
-    int node_count_ = 0;
-    int max_depth_ = 0;
+    std::array<char, 256> normalized_; // la de los patrones
+    std::array<char, 256> exact_;      // igual, pero sin plegar mayúsculas
+    std::vector<uint8_t> flags_;
+    size_t match_case_count_ = 0; // patrones con kMatchCase
+    size_t word_flag_count_ = 0;  // patrones con kWordStart o kWordEnd
+    std::array<bool, 256> word_byte_;
+    static constexpr PatternID kNoPattern = static_cast<PatternID>(-1);
+    std::vector<PatternID> canonical_;
+    // Cadena de alias de cada patrón canónico (kNoPattern al final).
+    std::vector<PatternID> next_alias_;
+    std::vector<uint8_t> removed_;
+    size_t tombstones_ = 0; // retirados que aún tienen salidas en el autómata
+    double compaction_threshold_ = 0.25;
+    size_t lazy_dfa_rows_ = 0;
+    Engine requested_engine_ = Engine::Auto;
+    Engine engine_ = Engine::AhoCorasick;
+    std::unique_ptr<LineSearcher> line_searcher_; // nulo con el autómata
+    std::future<Compaction> compaction_;
 
-    void split_lines(const std::string& text, std::vector<std::string>& lines) const;
-    void collect_matches(TrieNode* node, std::vector<MatchResult>& matches,
+    void collect_matches(StateID state, std::vector<MatchResult>& matches,
                          size_t line, size_t column,
-                         const std::string& line_text, size_t pos,
-                         size_t context_size) const;
-    void clear_trie();
-    void build_trie();
-    void build_failure_links();
-
-    struct TrieNode {
-        std::array<std::unique_ptr<TrieNode>, ALPHABET_SIZE> children;
-        bool is_end_of_word = false;
-        TrieNode* failure_link = nullptr;
-        TrieNode* output_link = nullptr;
-        std::vector<PatternID> pattern_indices;
-        int depth = 0;
-
-        TrieNode() = default;
-        TrieNode(const TrieNode&) = delete;
-        TrieNode& operator=(const TrieNode&) = delete;
+                         std::string_view line_text, size_t line_offset,
+                         size_t pos, size_t context_size,
+                         const uint8_t* neighbors) const;
+    void push_match(std::vector<MatchResult>& matches, PatternID canonical,
+                    size_t length, size_t line, size_t column,
+                    std::string_view line_text, size_t line_offset,
+                    size_t pos, size_t context_size, const uint8_t* neighbors) const;
+    void clean_into(std::string_view text, std::string& cleaned,
+                    const std::array<char, 256>& table) const;
+    // Con patrones que distinguen mayúsculas el texto se normaliza sin
+    // plegarlas para poder comprobarlas, y los contextos se pliegan aparte.
+    const std::array<char, 256>& text_table() const {
+        return match_case_count_ > 0 ? exact_ : normalized_;
+    }
+    bool raw_bytes() const { return automaton_.alphabet == Alphabet::Bytes; }
+    bool fold_context() const {
+        return match_case_count_ > 0 && !case_sensitive_ && !raw_bytes();
+    }
+    // text apunta al inicio de la coincidencia en el texto normalizado;
+    // word_before y word_after dicen si los bytes originales vecinos son de
+    // palabra.
+    bool accepts(PatternID id, const char* text, bool word_before, bool word_after) const;
+    void update_flag_counts(uint8_t flags, int delta);
+    void build_normalization();
+    void select_engine();
+    void search_lines(std::string_view text, size_t context_size,
+                      std::vector<MatchResult>& matches) const;
+    // Pasa una línea normalizada al motor, plegada a minúsculas si hace falta.
+    void scan_line(std::string_view line, std::string& folded,
+                   const LineSearcher::Emit& emit) const;
+    static std::string make_context(std::string_view line_text, size_t start, size_t end,
+                                    bool fold = false);
+    void normalize_patterns();
+    void check_id(PatternID id) const;
+    void link_aliases(PatternID first);
+    PatternID emitted_id(PatternID canonical, const char* text,
+                         bool word_before, bool word_after) const;
+    bool compaction_ready() const;
+    void start_compaction();
+    void install_compaction();
+};
+
+// Escáner reanudable: conserva el estado del autómata, el desplazamiento
+// global en bytes, la línea y la columna entre fragmentos, de modo que las
+// coincidencias que cruzan el borde de un fragmento se informan igual que
+// con search(). Solo retiene la ventana de la línea actual necesaria para
+// el contexto, así que la memoria no depende de la longitud del flujo.
+//
+// Modo extracción: feed() entrega un fragmento (que debe seguir vivo hasta
+// que next() devuelva false) y next() produce coincidencias bajo demanda.
+// Modo envío: feed(chunk, sink) y finish(sink) consumen todo el fragmento y
+// entregan las coincidencias al sumidero.
+class Scanner {
+public:
+    using Sink = std::function<void(const MatchResult&)>;
+
+    explicit Scanner(const PatternMatcher& matcher, size_t context_size = 20);
+
+    void feed(std::string_view chunk);
+    void feed(std::string_view chunk, const Sink& sink);
+    void finish();
+    void finish(const Sink& sink);
+    // Devuelve false cuando hace falta más entrada (o ya no queda nada).
+    bool next(MatchResult& match);
+
+    size_t line() const { return line_; }
+    size_t column() const { return column_; }
+    size_t offset() const { return offset_; }
+
+private:
+    struct Pending {
+        size_t pos;
+        size_t column;
+        size_t context_start;
+        size_t offset;
+        size_t length;
+        PatternID pattern_id;
     };
+
+    const PatternMatcher& matcher_;
+    // Solo si el matcher tiene activado el DFA perezoso.
+    std::unique_ptr<TransitionCache> transitions_;
+    StateID state_ = kRootState;
+    size_t context_size_;
+    std::string_view chunk_;
+    size_t chunk_pos_ = 0;
+    bool finishing_ = false;
+    size_t line_ = 1;
+    size_t column_ = 0;
+    size_t offset_ = 0;
+    // Ventana de la línea actual (ya normalizada) desde la columna
+    // window_start_, con el byte de origen de cada carácter y si el byte
+    // original anterior es de palabra.
+    std::string window_;
+    std::vector<size_t> window_offsets_;
+    std::vector<uint8_t> window_word_before_;
+    bool last_word_ = false; // clase del último byte de la línea
+    // Con límites de palabra, las salidas del último carácter esperan al
+    // byte siguiente para saber si acaban en un límite (kRootState: ninguna).
+    StateID deferred_state_ = kRootState;
+    size_t deferred_pos_ = 0;
+    size_t deferred_offset_ = 0;
+    size_t window_start_ = 0;
+    std::deque<Pending> pending_;
+    std::deque<MatchResult> ready_;
+
+    void consume(unsigned char c);
+    void emit_outputs(StateID state, size_t pos, size_t byte_offset, bool word_after);
+    void end_line();
+    void release(const Pending& pending);
+    void trim_window();
 };
 
 } // namespace ahocorasick
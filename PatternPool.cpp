@@ -0,0 +1,89 @@
+#include "PatternPool.h"
+
+#include "InputSource.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ahocorasick {
+
+PatternPool::PatternPool(const std::vector<std::string>& patterns) : offsets_(1, 0) {
+    size_t bytes = 0;
+    for (const auto& pattern : patterns) bytes += pattern.size();
+    reserve(patterns.size(), bytes);
+    for (const auto& pattern : patterns) add(pattern);
+}
+
+PatternPool::PatternPool(std::vector<std::string>&& patterns) : offsets_(1, 0) {
+    size_t bytes = 0;
+    for (const auto& pattern : patterns) bytes += pattern.size();
+    reserve(patterns.size(), bytes);
+    for (auto& pattern : patterns) {
+        add(pattern);
+        std::string().swap(pattern);
+    }
+    std::vector<std::string>().swap(patterns);
+}
+
+PatternPool PatternPool::load(const std::string& file_path) {
+    MappedFile file(file_path);
+    std::string_view text = file.view();
+
+    PatternPool pool;
+    pool.reserve(static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) + 1,
+                 text.size());
+    size_t line_start = 0;
+    while (line_start < text.size()) {
+        size_t line_end = text.find('\n', line_start);
+        if (line_end == std::string_view::npos) line_end = text.size();
+        if (line_end > line_start) pool.add(text.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
+    }
+    if (pool.empty()) {
+        throw std::runtime_error("El archivo de patrones está vacío o no contiene patrones válidos");
+    }
+    return pool;
+}
+
+PatternPool PatternPool::from_parts(std::string_view bytes, const uint64_t* offsets,
+                                   size_t count) {
+    if (offsets[0] != 0 || offsets[count] != bytes.size()) {
+        throw std::runtime_error("Desplazamientos de patrones inválidos");
+    }
+    PatternPool pool;
+    pool.bytes_.assign(bytes.data(), bytes.size());
+    pool.offsets_.resize(count + 1);
+    for (size_t i = 1; i <= count; ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            throw std::runtime_error("Desplazamientos de patrones inválidos");
+        }
+        pool.offsets_[i] = static_cast<size_t>(offsets[i]);
+    }
+    return pool;
+}
+
+void PatternPool::reserve(size_t count, size_t bytes) {
+    offsets_.reserve(count + 1);
+    bytes_.reserve(bytes);
+}
+
+void PatternPool::add(std::string_view pattern) {
+    bytes_.append(pattern.data(), pattern.size());
+    offsets_.push_back(bytes_.size());
+}
+
+void PatternPool::append(const PatternPool& other) {
+    const size_t base = bytes_.size();
+    bytes_ += other.bytes_;
+    offsets_.reserve(offsets_.size() + other.size());
+    for (size_t i = 1; i < other.offsets_.size(); ++i) {
+        offsets_.push_back(base + other.offsets_[i]);
+    }
+}
+
+void PatternPool::clear() {
+    bytes_.clear();
+    offsets_.assign(1, 0);
+}
+
+} // namespace ahocorasick
@@ -0,0 +1,80 @@
+#ifndef PATTERN_POOL_H
+#define PATTERN_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ahocorasick {
+
+// Patrones guardados en un único bloque contiguo con un arreglo de
+// desplazamientos: el patrón i ocupa bytes [offsets[i], offsets[i + 1]).
+// Evita una reserva de memoria por patrón en diccionarios de millones de
+// líneas.
+class PatternPool {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        const_iterator(const PatternPool* pool, size_t index) : pool_(pool), index_(index) {}
+        std::string_view operator*() const { return (*pool_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index_; return old; }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+        }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        const PatternPool* pool_;
+        size_t index_;
+    };
+
+    PatternPool() : offsets_(1, 0) {}
+    explicit PatternPool(const std::vector<std::string>& patterns);
+    // Igual, pero libera cada cadena en cuanto la copia al bloque, de modo
+    // que el pico de memoria no es la suma de ambas representaciones.
+    explicit PatternPool(std::vector<std::string>&& patterns);
+
+    // Carga un archivo con un patrón por línea (se ignoran las vacías)
+    // proyectándolo en memoria y copiando cada línea una sola vez al bloque.
+    static PatternPool load(const std::string& file_path);
+
+    // Reconstruye un bloque volcado con bytes() y offsets() (count + 1
+    // desplazamientos); lanza std::runtime_error si no son coherentes.
+    static PatternPool from_parts(std::string_view bytes, const uint64_t* offsets, size_t count);
+
+    void reserve(size_t count, size_t bytes);
+    void add(std::string_view pattern);
+    void append(const PatternPool& other);
+    void clear();
+
+    size_t size() const { return offsets_.size() - 1; }
+    bool empty() const { return size() == 0; }
+    size_t total_bytes() const { return bytes_.size(); }
+    std::string_view bytes() const { return bytes_; }
+    const std::vector<size_t>& offsets() const { return offsets_; }
+    std::string_view operator[](size_t index) const {
+        return std::string_view(bytes_.data() + offsets_[index],
+                                offsets_[index + 1] - offsets_[index]);
+    }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    std::string bytes_;
+    std::vector<size_t> offsets_;
+};
+
+} // namespace ahocorasick
+
+#endif // PATTERN_POOL_H
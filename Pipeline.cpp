@@ -0,0 +1,278 @@
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace ahocorasick {
+
+Pipeline::Pipeline(const PatternMatcher& matcher, PipelineOptions options)
+    : matcher_(matcher), options_(options) {
+    if (options_.block_size == 0) {
+        throw std::invalid_argument("El tamaño de bloque debe ser mayor que cero");
+    }
+    if (options_.matcher_threads == 0) {
+        options_.matcher_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    options_.queue_capacity = std::max<size_t>(options_.queue_capacity, 2);
+}
+
+namespace {
+
+// Reagrupa los bloques de una BlockSource, de tamaño arbitrario, en bloques
+// de al menos block_size bytes cortados en saltos de línea.
+class LineBlocks {
+public:
+    LineBlocks(BlockSource& source, size_t block_size)
+        : source_(source), block_size_(block_size) {}
+
+    bool operator()(std::string& text) {
+        size_t cut = std::string::npos;
+        while (!done_) {
+            if (carry_.size() >= block_size_) {
+                cut = carry_.rfind('\n');
+                if (cut != std::string::npos) break;
+            }
+            const std::string_view block = source_.next();
+            if (block.empty()) {
+                done_ = true;
+            } else {
+                carry_.append(block);
+            }
+        }
+        if (carry_.empty()) return false;
+        if (done_) {
+            text.swap(carry_);
+            carry_.clear();
+        } else {
+            text.assign(carry_, 0, cut + 1);
+            carry_.erase(0, cut + 1);
+        }
+        return true;
+    }
+
+private:
+    BlockSource& source_;
+    size_t block_size_;
+    std::string carry_;
+    bool done_ = false;
+};
+
+} // namespace
+
+Pipeline::ReadBlock Pipeline::stream_reader(std::istream& input) const {
+    return [&input, block_size = options_.block_size](std::string& text) {
+        if (!input) return false;
+        text.resize(block_size);
+        input.read(&text[0], static_cast<std::streamsize>(text.size()));
+        text.resize(static_cast<size_t>(input.gcount()));
+        if (text.empty()) return false;
+        if (text.back() != '\n') {
+            std::string rest;
+            if (std::getline(input, rest)) {
+                text += rest;
+                if (!input.eof()) text += '\n';
+            }
+        }
+        return true;
+    };
+}
+
+size_t Pipeline::run(std::istream& input, const Sink& sink) {
+    return run_stages(stream_reader(input), sink, nullptr);
+}
+
+size_t Pipeline::run(std::istream& input, const Sink& sink, MatchStats& stats) {
+    return run_stages(stream_reader(input), sink, &stats);
+}
+
+size_t Pipeline::run(BlockSource& input, const Sink& sink) {
+    return run_stages(LineBlocks(input, options_.block_size), sink, nullptr);
+}
+
+size_t Pipeline::run(BlockSource& input, const Sink& sink, MatchStats& stats) {
+    return run_stages(LineBlocks(input, options_.block_size), sink, &stats);
+}
+
+size_t Pipeline::run_stages(const ReadBlock& read, const Sink& sink, MatchStats* stats) {
+    const size_t workers = options_.matcher_threads;
+    // Límite de bloques entre el lector y el sumidero: acota también el
+    // buffer de reordenamiento cuando un bloque tarda más que los demás.
+    const size_t max_in_flight = 2 * options_.queue_capacity + workers;
+
+    BoundedQueue<Block> raw_blocks(options_.queue_capacity);
+    BoundedQueue<Block> clean_blocks(options_.queue_capacity);
+    BoundedQueue<BlockResult> results(options_.queue_capacity);
+    std::atomic<size_t> emitted{0};
+    std::atomic<size_t> active_matchers{workers};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<MatchStats> shards;
+    if (stats) {
+        shards.assign(workers, MatchStats(matcher_.patterns().size(),
+                                          stats->lines_per_bucket()));
+    }
+
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = e;
+        }
+        failed.store(true);
+        raw_blocks.close();
+        clean_blocks.close();
+        results.close();
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+        try {
+            size_t sequence = 0;
+            size_t line = 1;
+            size_t offset = 0;
+            while (!failed.load()) {
+                Block block;
+                block.sequence = sequence;
+                block.first_line = line;
+                block.offset = offset;
+                if (!read(block.text)) break;
+                line += static_cast<size_t>(std::count(block.text.begin(), block.text.end(), '\n'));
+                offset += block.text.size();
+
+                for (unsigned spins = 0;
+                     sequence >= emitted.load() + max_in_flight && !failed.load(); ++spins) {
+                    if (spins < 1024) {
+                        std::this_thread::yield();
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                }
+                if (!raw_blocks.push(std::move(block))) break;
+                ++sequence;
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        raw_blocks.close();
+    });
+
+    threads.emplace_back([&]() {
+        try {
+            Block block;
+            std::string cleaned;
+            while (raw_blocks.pop(block)) {
+                if (matcher_.alphabet() == Alphabet::Bytes) {
+                    // El autómata recorre los bytes tal cual: no hay nada que
+                    // limpiar y los desplazamientos ya son los del original.
+                    if (!clean_blocks.push(std::move(block))) break;
+                    continue;
+                }
+                cleaned.clear();
+                cleaned.reserve(block.text.size());
+                block.drops.clear();
+                block.neighbors.clear();
+                const bool boundaries = matcher_.uses_word_boundaries();
+                size_t dropped = 0;
+                bool prev_word = false;
+                bool prev_kept = false;
+                for (unsigned char c : block.text) {
+                    char normalized = matcher_.normalize_byte(c);
+                    if (boundaries) {
+                        const bool word = matcher_.is_word_byte(c);
+                        if (word && prev_kept) block.neighbors.back() |= kWordAfter;
+                        if (normalized != '\0') {
+                            block.neighbors.push_back(prev_word ? kWordBefore : 0);
+                        }
+                        prev_word = word;
+                        prev_kept = normalized != '\0';
+                    }
+                    if (normalized == '\0') {
+                        ++dropped;
+                        continue;
+                    }
+                    if (dropped != (block.drops.empty() ? 0 : block.drops.back().second)) {
+                        block.drops.emplace_back(cleaned.size(), dropped);
+                    }
+                    cleaned += normalized;
+                }
+                block.text.swap(cleaned);
+                if (!clean_blocks.push(std::move(block))) break;
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        clean_blocks.close();
+    });
+
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&, i]() {
+            try {
+                Block block;
+                while (clean_blocks.pop(block)) {
+                    BlockResult result;
+                    result.sequence = block.sequence;
+                    matcher_.scan_cleaned(block.text, block.first_line,
+                                          options_.context_size, result.matches,
+                                          block.neighbors.empty() ? nullptr
+                                                                  : block.neighbors.data());
+                    auto to_raw = [&](size_t pos) {
+                        auto it = std::upper_bound(
+                            block.drops.begin(), block.drops.end(),
+                            std::make_pair(pos, std::numeric_limits<size_t>::max()));
+                        return pos + (it == block.drops.begin() ? 0 : std::prev(it)->second);
+                    };
+                    for (auto& match : result.matches) {
+                        const size_t first = to_raw(match.offset);
+                        const size_t last = to_raw(match.offset + match.length - 1);
+                        match.offset = block.offset + first;
+                        match.length = last + 1 - first;
+                    }
+                    std::sort(result.matches.begin(), result.matches.end());
+                    if (stats) {
+                        for (const auto& match : result.matches) shards[i].add(match);
+                    }
+                    if (!results.push(std::move(result))) break;
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            if (--active_matchers == 0) results.close();
+        });
+    }
+
+    size_t total = 0;
+    try {
+        std::map<size_t, std::vector<MatchResult>> pending;
+        size_t next = 0;
+        BlockResult result;
+        while (results.pop(result)) {
+            pending.emplace(result.sequence, std::move(result.matches));
+            while (!pending.empty() && pending.begin()->first == next) {
+                for (const auto& match : pending.begin()->second) {
+                    sink(match);
+                    ++total;
+                }
+                pending.erase(pending.begin());
+                emitted.store(++next);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    for (auto& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+    if (stats) {
+        shards.push_back(std::move(*stats));
+        *stats = MatchStats::merge_tree(std::move(shards));
+    }
+    return total;
+}
+
+} // namespace ahocorasick
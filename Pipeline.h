@@ -0,0 +1,76 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "BoundedQueue.h"
+#include "InputSource.h"
+#include "MatchStats.h"
+#include "PatternMatcher.h"
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <utility>
+#include <vector>
+
+namespace ahocorasick {
+
+struct PipelineOptions {
+    size_t block_size = 1 << 20;
+    size_t matcher_threads = 0; // 0 = núcleos disponibles
+    size_t queue_capacity = 8;
+    size_t context_size = 20;
+};
+
+// Ejecuta lector -> normalizador -> N buscadores -> sumidero en hilos
+// separados. Los bloques se cortan en saltos de línea, por lo que cada uno
+// se procesa de forma independiente y el sumidero recibe las coincidencias
+// en el mismo orden que search().
+class Pipeline {
+public:
+    using Sink = std::function<void(const MatchResult&)>;
+
+    explicit Pipeline(const PatternMatcher& matcher, PipelineOptions options = {});
+
+    // Devuelve el número total de coincidencias entregadas al sumidero.
+    size_t run(std::istream& input, const Sink& sink);
+    // Igual que run(), y además cada hilo buscador llena su propio fragmento
+    // de estadísticas; al terminar se combinan en árbol dentro de stats.
+    size_t run(std::istream& input, const Sink& sink, MatchStats& stats);
+    // Igual, leyendo de una fuente de bloques (por ejemplo la de
+    // open_block_source(), que descomprime gzip y zstd); los bloques se
+    // reagrupan hasta block_size y se cortan en saltos de línea.
+    size_t run(BlockSource& input, const Sink& sink);
+    size_t run(BlockSource& input, const Sink& sink, MatchStats& stats);
+
+private:
+    struct Block {
+        size_t sequence = 0;
+        size_t first_line = 1;
+        size_t offset = 0;
+        std::string text;
+        // (posición normalizada, bytes descartados antes de ella) en cada
+        // punto donde cambia el acumulado; permite recuperar MatchResult::offset.
+        std::vector<std::pair<size_t, size_t>> drops;
+        // NeighborBit de cada carácter normalizado, tomados de los bytes
+        // originales; vacío si ningún patrón exige límites de palabra.
+        std::vector<uint8_t> neighbors;
+    };
+    struct BlockResult {
+        size_t sequence = 0;
+        std::vector<MatchResult> matches;
+    };
+
+    const PatternMatcher& matcher_;
+    PipelineOptions options_;
+
+    // read llena el texto del siguiente bloque, terminado en salto de línea
+    // salvo el último; devuelve false al final de la entrada.
+    using ReadBlock = std::function<bool(std::string& text)>;
+
+    ReadBlock stream_reader(std::istream& input) const;
+    size_t run_stages(const ReadBlock& read, const Sink& sink, MatchStats* stats);
+};
+
+} // namespace ahocorasick
+
+#endif // PIPELINE_H
@@ -0,0 +1,309 @@
+#include "ResultWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ahocorasick {
+
+namespace {
+
+void write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Error al escribir la salida: ") +
+                                     std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void store_le(char* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+} // namespace
+
+OutputBuffer::OutputBuffer(const std::string& path, size_t capacity)
+    : fd_(path == "-" ? STDOUT_FILENO : ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+      owns_fd_(path != "-"), buffer_(std::max<size_t>(capacity, 64)) {
+    if (fd_ < 0) {
+        throw std::runtime_error("No se pudo abrir el archivo para escritura: " + path);
+    }
+}
+
+OutputBuffer::~OutputBuffer() {
+    try {
+        flush();
+    } catch (...) {
+        // Un destructor no puede propagar el error; finish() ya lo habría hecho.
+    }
+    if (owns_fd_) ::close(fd_);
+}
+
+void OutputBuffer::write(std::string_view text) {
+    if (text.size() > buffer_.size() - used_) {
+        flush();
+        if (text.size() >= buffer_.size()) {
+            write_all(fd_, text.data(), text.size());
+            return;
+        }
+    }
+    std::memcpy(buffer_.data() + used_, text.data(), text.size());
+    used_ += text.size();
+}
+
+void OutputBuffer::write_number(uint64_t value) {
+    char digits[20];
+    auto end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+    write(std::string_view(digits, static_cast<size_t>(end - digits)));
+}
+
+void OutputBuffer::flush() {
+    const size_t used = used_;
+    used_ = 0;
+    write_all(fd_, buffer_.data(), used);
+}
+
+TextWriter::TextWriter(const std::string& path) : out_(path) {}
+
+void TextWriter::write(std::string_view document, const MatchResult& match) {
+    if (!document.empty()) {
+        out_.write(document);
+        out_.put(':');
+    }
+    out_.write_number(match.line);
+    out_.put(':');
+    out_.write_number(match.column);
+    out_.put(':');
+    out_.write(match.pattern);
+    out_.put(':');
+    out_.write(match.context);
+    out_.put('\n');
+}
+
+void TextWriter::finish() { out_.flush(); }
+
+HtmlReport::HtmlReport(const std::string& path, const PatternPool& patterns)
+    : out_(path), patterns_(patterns), stats_(patterns.size()) {
+    out_.write("<!DOCTYPE html>\n<html lang='es'>\n<head>\n"
+               "<meta charset='UTF-8'>\n"
+               "<title>Resultados de Análisis</title>\n"
+               "<style>\n"
+               "body { font-family: Arial, sans-serif; line-height: 1.6; }\n"
+               ".report { display: flex; flex-direction: column; }\n"
+               ".match { margin-bottom: 15px; border-left: 3px solid #3498db; padding-left: 10px; }\n"
+               ".pattern { font-weight: bold; color: #e74c3c; }\n"
+               ".context { color: #7f8c8d; font-style: italic; }\n"
+               ".summary { background-color: #f9f9f9; padding: 15px; margin-bottom: 20px; order: -1; }\n"
+               "</style>\n</head>\n<body>\n"
+               "<h1>Resultados de Análisis de Texto</h1>\n"
+               "<div class='report'>\n"
+               "<h2>Detalles de Coincidencias</h2>\n");
+}
+
+void HtmlReport::write(std::string_view document, const MatchResult& match) {
+    stats_.add(match);
+    out_.write("<div class='match'>\n<p><strong>");
+    if (!document.empty()) {
+        write_escaped(document);
+        out_.write(", ");
+    }
+    out_.write("Línea ");
+    out_.write_number(match.line);
+    out_.write(", Columna ");
+    out_.write_number(match.column);
+    out_.write(":</strong> Patrón: <span class='pattern'>");
+    write_escaped(match.pattern);
+    out_.write("</span></p>\n<p class='context'>Contexto: \"");
+    write_escaped(match.context);
+    out_.write("\"</p>\n</div>\n");
+}
+
+void HtmlReport::finish() { finish(stats_); }
+
+void HtmlReport::finish(const MatchStats& stats) {
+    if (finished_) return;
+    finished_ = true;
+    out_.write("<div class='summary'>\n<h2>Resumen</h2>\n<p>Total de coincidencias: ");
+    out_.write_number(stats.total());
+    out_.write("</p>\n<h3>Coincidencias por patrón:</h3>\n<ul>\n");
+    for (PatternID id = 0; id < stats.counts().size(); ++id) {
+        if (stats.counts()[id] == 0) continue;
+        out_.write("<li>");
+        write_escaped(patterns_[id]);
+        out_.write(": ");
+        out_.write_number(stats.counts()[id]);
+        out_.write(" coincidencias</li>\n");
+    }
+    out_.write("</ul>\n</div>\n</div>\n</body>\n</html>\n");
+    out_.flush();
+}
+
+void HtmlReport::write_escaped(std::string_view text) {
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char* entity = nullptr;
+        switch (text[i]) {
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '&': entity = "&amp;"; break;
+            default: continue;
+        }
+        out_.write(text.substr(start, i - start));
+        out_.write(entity);
+        start = i + 1;
+    }
+    out_.write(text.substr(start));
+}
+
+JsonLinesWriter::JsonLinesWriter(const std::string& path) : out_(path) {}
+
+void JsonLinesWriter::write(std::string_view document, const MatchResult& match) {
+    out_.write("{\"doc\":");
+    write_string(document);
+    out_.write(",\"line\":");
+    out_.write_number(match.line);
+    out_.write(",\"column\":");
+    out_.write_number(match.column);
+    out_.write(",\"offset\":");
+    out_.write_number(match.offset);
+    out_.write(",\"length\":");
+    out_.write_number(match.length);
+    out_.write(",\"pattern_id\":");
+    out_.write_number(match.pattern_id);
+    out_.write(",\"pattern\":");
+    write_string(match.pattern);
+    out_.write(",\"context\":");
+    write_string(match.context);
+    out_.write("}\n");
+}
+
+void JsonLinesWriter::finish() { out_.flush(); }
+
+void JsonLinesWriter::write_string(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out_.put('"');
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out_.write(text.substr(start, i - start));
+        out_.put('\\');
+        if (c == '"' || c == '\\') {
+            out_.put(static_cast<char>(c));
+        } else {
+            out_.write("u00");
+            out_.put(hex[c >> 4]);
+            out_.put(hex[c & 0xf]);
+        }
+        start = i + 1;
+    }
+    out_.write(text.substr(start));
+    out_.put('"');
+}
+
+CsvWriter::CsvWriter(const std::string& path) : out_(path) {
+    out_.write("doc,line,column,offset,length,pattern_id,pattern,context\r\n");
+}
+
+void CsvWriter::write(std::string_view document, const MatchResult& match) {
+    write_field(document);
+    out_.put(',');
+    out_.write_number(match.line);
+    out_.put(',');
+    out_.write_number(match.column);
+    out_.put(',');
+    out_.write_number(match.offset);
+    out_.put(',');
+    out_.write_number(match.length);
+    out_.put(',');
+    out_.write_number(match.pattern_id);
+    out_.put(',');
+    write_field(match.pattern);
+    out_.put(',');
+    write_field(match.context);
+    out_.write("\r\n");
+}
+
+void CsvWriter::finish() { out_.flush(); }
+
+void CsvWriter::write_field(std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out_.write(text);
+        return;
+    }
+    out_.put('"');
+    size_t start = 0;
+    for (size_t quote = text.find('"'); quote != std::string_view::npos;
+         quote = text.find('"', start)) {
+        out_.write(text.substr(start, quote + 1 - start));
+        out_.put('"');
+        start = quote + 1;
+    }
+    out_.write(text.substr(start));
+    out_.put('"');
+}
+
+BinaryRecordWriter::BinaryRecordWriter(const std::string& path) : out_(path) {}
+
+uint32_t BinaryRecordWriter::document_id(std::string_view document) {
+    if (current_ < documents_.size() && documents_[current_] == document) return current_;
+    auto [it, inserted] = ids_.try_emplace(std::string(document),
+                                           static_cast<uint32_t>(documents_.size()));
+    if (inserted) documents_.emplace_back(document);
+    current_ = it->second;
+    return current_;
+}
+
+void BinaryRecordWriter::begin_document(std::string_view document) {
+    document_id(document);
+}
+
+void BinaryRecordWriter::write(std::string_view document, const MatchResult& match) {
+    char record[kRecordSize];
+    store_le(record, document_id(document), 4);
+    store_le(record + 4, match.pattern_id, 4);
+    store_le(record + 8, match.offset, 8);
+    store_le(record + 16, match.length, 4);
+    store_le(record + 20, 0, 4);
+    out_.write(std::string_view(record, sizeof record));
+}
+
+void BinaryRecordWriter::finish() {
+    if (!finished_) {
+        finished_ = true;
+        char field[8];
+        size_t table_bytes = 0;
+        for (const std::string& document : documents_) {
+            store_le(field, document.size(), 4);
+            out_.write(std::string_view(field, 4));
+            out_.write(document);
+            table_bytes += 4 + document.size();
+        }
+        static const char padding[8] = {};
+        const size_t pad = (8 - table_bytes % 8) % 8;
+        out_.write(std::string_view(padding, pad));
+        table_bytes += pad;
+
+        char footer[kRecordSize];
+        std::memcpy(footer, kTrailerMagic, sizeof kTrailerMagic);
+        store_le(footer + 8, table_bytes, 8);
+        store_le(footer + 16, documents_.size(), 4);
+        store_le(footer + 20, 0, 4);
+        out_.write(std::string_view(footer, sizeof footer));
+    }
+    out_.flush();
+}
+
+} // namespace ahocorasick
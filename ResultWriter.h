@@ -0,0 +1,160 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include "MatchStats.h"
+#include "PatternMatcher.h"
+#include "PatternPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ahocorasick {
+
+// Salida con un buffer grande sobre un descriptor: las coincidencias se
+// formatean directamente en el buffer, sin cadenas intermedias, y solo se
+// llama a write() cuando se llena.
+class OutputBuffer {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    // "-" escribe en la salida estándar.
+    explicit OutputBuffer(const std::string& path, size_t capacity = kDefaultCapacity);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(std::string_view text);
+    void put(char c) {
+        if (used_ == buffer_.size()) flush();
+        buffer_[used_++] = c;
+    }
+    void write_number(uint64_t value);
+    void flush();
+
+private:
+    int fd_;
+    bool owns_fd_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+};
+
+// Destino de las coincidencias de una búsqueda, pensado para conectarse al
+// sumidero de Scanner, Pipeline o CorpusScanner y escribir a medida que se
+// encuentran, sin acumularlas en memoria.
+class ResultWriter {
+public:
+    virtual ~ResultWriter() = default;
+    // document es el archivo de origen ("" si solo hay uno).
+    virtual void write(std::string_view document, const MatchResult& match) = 0;
+    // Anuncia un documento antes de sus coincidencias, aunque no tenga
+    // ninguna; los formatos que numeran documentos lo usan para el orden.
+    virtual void begin_document(std::string_view document) { (void)document; }
+    // Escribe lo que el formato deja para el final y vacía el buffer.
+    virtual void finish() = 0;
+};
+
+// "documento:línea:columna:patrón:contexto", el formato del modo no
+// interactivo.
+class TextWriter : public ResultWriter {
+public:
+    explicit TextWriter(const std::string& path);
+
+    void write(std::string_view document, const MatchResult& match) override;
+    void finish() override;
+
+private:
+    OutputBuffer out_;
+};
+
+// Informe HTML escrito en streaming. Los recuentos por patrón se llevan en
+// un MatchStats (memoria proporcional al número de patrones, no al de
+// coincidencias) y el resumen se escribe al final del archivo; el CSS lo
+// muestra igualmente antes de los detalles.
+class HtmlReport : public ResultWriter {
+public:
+    HtmlReport(const std::string& path, const PatternPool& patterns);
+
+    void write(std::string_view document, const MatchResult& match) override;
+    void finish() override;
+    // Igual que finish(), pero con estadísticas ya calculadas aparte.
+    void finish(const MatchStats& stats);
+
+    const MatchStats& stats() const { return stats_; }
+
+private:
+    OutputBuffer out_;
+    const PatternPool& patterns_;
+    MatchStats stats_;
+    bool finished_ = false;
+
+    void write_escaped(std::string_view text);
+};
+
+// Un objeto JSON por línea con doc, line, column, offset, length,
+// pattern_id, pattern y context.
+class JsonLinesWriter : public ResultWriter {
+public:
+    explicit JsonLinesWriter(const std::string& path);
+
+    void write(std::string_view document, const MatchResult& match) override;
+    void finish() override;
+
+private:
+    OutputBuffer out_;
+
+    void write_string(std::string_view text);
+};
+
+// CSV (RFC 4180) con una fila de cabecera y las mismas columnas que JSONL.
+class CsvWriter : public ResultWriter {
+public:
+    explicit CsvWriter(const std::string& path);
+
+    void write(std::string_view document, const MatchResult& match) override;
+    void finish() override;
+
+private:
+    OutputBuffer out_;
+
+    void write_field(std::string_view text);
+};
+
+// Registros binarios de ancho fijo, en little-endian y sin cabecera:
+//   doc u32 | pattern_id u32 | offset u64 | length u32 | reservado u32 (0)
+// doc numera desde 0 los documentos en el orden de begin_document() (y los
+// no anunciados, en el de su primera coincidencia). finish() añade detrás
+// la tabla de documentos, para que el archivo se lea sin nada más: por cada
+// uno, longitud u32 y nombre, con relleno hasta múltiplo de 8, y al final
+// un pie de kRecordSize bytes:
+//   "ACDOCS\0\0" | bytes de la tabla u64 | documentos u32 | reservado u32 (0)
+class BinaryRecordWriter : public ResultWriter {
+public:
+    static constexpr size_t kRecordSize = 24;
+    static constexpr char kTrailerMagic[8] = {'A', 'C', 'D', 'O', 'C', 'S', '\0', '\0'};
+
+    explicit BinaryRecordWriter(const std::string& path);
+
+    void write(std::string_view document, const MatchResult& match) override;
+    void begin_document(std::string_view document) override;
+    void finish() override;
+
+    const std::vector<std::string>& documents() const { return documents_; }
+
+private:
+    OutputBuffer out_;
+    std::vector<std::string> documents_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    uint32_t current_ = 0; // último documento usado, para no buscarlo cada vez
+    bool finished_ = false;
+
+    uint32_t document_id(std::string_view document);
+};
+
+} // namespace ahocorasick
+
+#endif // RESULT_WRITER_H
@@ -0,0 +1,292 @@
+#include "SearchEngine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string.h> // memmem
+
+namespace ahocorasick {
+
+namespace {
+
+// Hasta este número de patrones compensa recorrer la línea una vez por
+// patrón con memmem, que compara bloques enteros con instrucciones SIMD.
+constexpr size_t kMemmemMaxPatterns = 3;
+
+class MemmemSearcher : public LineSearcher {
+public:
+    explicit MemmemSearcher(const std::vector<EngineKey>& keys) : keys_(keys) {}
+
+    void scan(std::string_view line, const Emit& emit) const override {
+        const char* const end = line.data() + line.size();
+        for (const EngineKey& key : keys_) {
+            const size_t length = key.text.size();
+            const char* from = line.data();
+            while (static_cast<size_t>(end - from) >= length) {
+                const void* found = ::memmem(from, static_cast<size_t>(end - from),
+                                             key.text.data(), length);
+                if (!found) break;
+                const char* hit = static_cast<const char*>(found);
+                emit(static_cast<size_t>(hit - line.data()) + length - 1, key.id);
+                from = hit + 1; // las apariciones pueden solaparse
+            }
+        }
+    }
+
+private:
+    std::vector<EngineKey> keys_;
+};
+
+// Suma de longitudes hasta la que los patrones caben en un registro de
+// 128 bits (dos de 64 en la práctica) para ShiftOrSearcher.
+constexpr size_t kShiftOrMaxBits = 128;
+
+// Shift-Or multipatrón en su forma complementada (Shift-And): los patrones
+// se concatenan en los bits de una palabra y cada byte de la línea cuesta
+// un desplazamiento, un OR y un AND con la máscara del carácter, sin saltos
+// ni accesos a memoria que dependan del estado. El bit de inicio de cada
+// patrón se fuerza en cada paso, así que lo que se desborda del final de
+// un patrón al inicio del siguiente no altera nada.
+template <typename Word>
+class ShiftOrSearcher : public LineSearcher {
+public:
+    explicit ShiftOrSearcher(const std::vector<EngineKey>& keys) {
+        size_t bit = 0;
+        for (const EngineKey& key : keys) {
+            starts_ |= Word(1) << bit;
+            for (unsigned char c : key.text) masks_[c] |= Word(1) << bit++;
+            ends_ |= Word(1) << (bit - 1);
+            ids_[bit - 1] = key.id;
+        }
+    }
+
+    void scan(std::string_view line, const Emit& emit) const override {
+        Word state = 0;
+        for (size_t pos = 0; pos < line.size(); ++pos) {
+            state = ((state << 1) | starts_) & masks_[static_cast<unsigned char>(line[pos])];
+            Word found = state & ends_;
+            while (found) {
+                const size_t bit = lowest_bit(found);
+                emit(pos, ids_[bit]);
+                found &= found - 1;
+            }
+        }
+    }
+
+private:
+    Word masks_[256] = {};
+    Word starts_ = 0;
+    Word ends_ = 0;
+    PatternID ids_[sizeof(Word) * 8] = {}; // patrón que termina en cada bit
+
+    static size_t lowest_bit(Word word) {
+        const uint64_t low = static_cast<uint64_t>(word);
+        if (low) return static_cast<size_t>(__builtin_ctzll(low));
+        return 64 + static_cast<size_t>(__builtin_ctzll(static_cast<uint64_t>(word >> 32 >> 32)));
+    }
+};
+
+// Wu-Manber compensa cuando todos los patrones tienen al menos esta
+// longitud y no son tantos como para que la tabla de saltos se llene de
+// ceros.
+constexpr size_t kWuManberMinLength = 8;
+constexpr size_t kWuManberMaxPatterns = 5000;
+// Con menos símbolos distintos (ADN, binario, dígitos sueltos) casi todos
+// los bloques de B caracteres salen en algún prefijo y los saltos son 0.
+constexpr size_t kWuManberMinAlphabet = 8;
+// Entradas como máximo de la tabla de saltos (radix^B).
+constexpr size_t kWuManberMaxTable = 1 << 18;
+
+// Wu-Manber: se mira el bloque de B caracteres que acaba en la posición
+// actual y la tabla de saltos dice cuánto puede avanzarse sin perder
+// ninguna aparición (la distancia desde la última vez que ese bloque sale
+// en el prefijo de longitud mínima de algún patrón). Solo con salto 0 se
+// verifican los patrones de su cubeta. Los bloques se indexan por clases de
+// equivalencia de los bytes de los patrones (0 para los que no aparecen en
+// ninguno), igual que las columnas del autómata. Con el alfabeto de letras
+// caben todas sin colisiones; con bytes crudos, si radix^B no cabe en la
+// tabla, las clases se pliegan módulo radix. Una colisión solo puede acortar
+// un salto, nunca hacer perder una aparición.
+class WuManberSearcher : public LineSearcher {
+public:
+    explicit WuManberSearcher(const std::vector<EngineKey>& keys) : keys_(keys) {
+        std::fill(std::begin(symbol_), std::end(symbol_), 0);
+        size_t classes = 1;
+        for (const EngineKey& key : keys_) {
+            for (unsigned char c : key.text) {
+                if (symbol_[c] == 0) symbol_[c] = static_cast<uint8_t>(classes++);
+            }
+        }
+        min_length_ = SIZE_MAX;
+        for (const EngineKey& key : keys_) min_length_ = std::min(min_length_, key.text.size());
+        if (keys_.empty() || min_length_ < 2) {
+            throw std::invalid_argument("wu-manber necesita patrones de al menos 2 caracteres");
+        }
+        // Con pocos bloques distintos en los prefijos basta B = 2; si no, los
+        // saltos serían casi siempre 0 y se pasa a B = 3.
+        const size_t prefix_blocks = keys_.size() * (min_length_ - 1);
+        block_ = (min_length_ >= 3 && prefix_blocks > classes * classes / 4) ? 3 : 2;
+        radix_ = classes;
+        auto table_for = [&](size_t radix) {
+            size_t size = 1;
+            for (size_t i = 0; i < block_; ++i) size *= radix;
+            return size;
+        };
+        while (table_for(radix_) > kWuManberMaxTable) --radix_;
+        for (uint8_t& symbol : symbol_) symbol = static_cast<uint8_t>(symbol % radix_);
+        const size_t table_size = table_for(radix_);
+
+        const size_t default_shift = min_length_ - block_ + 1;
+        shift_.assign(table_size, static_cast<uint32_t>(default_shift));
+        // Cubetas por el prefijo de longitud mínima entero, no por su último
+        // bloque: en diccionarios de códigos o identificadores todos los
+        // patrones suelen acabar igual y una sola cubeta los tendría a todos.
+        size_t buckets = 1;
+        while (buckets < 2 * keys_.size()) buckets <<= 1;
+        bucket_mask_ = buckets - 1;
+        bucket_start_.assign(buckets + 1, 0);
+        for (const EngineKey& key : keys_) {
+            for (size_t q = block_; q <= min_length_; ++q) {
+                uint32_t& shift = shift_[hash(key.text.data() + q - block_)];
+                shift = std::min<uint32_t>(shift, static_cast<uint32_t>(min_length_ - q));
+            }
+            ++bucket_start_[prefix_hash(key.text.data()) + 1];
+        }
+        for (size_t h = 0; h < buckets; ++h) bucket_start_[h + 1] += bucket_start_[h];
+        bucket_.resize(keys_.size());
+        std::vector<uint32_t> fill(bucket_start_.begin(), bucket_start_.end() - 1);
+        for (uint32_t i = 0; i < keys_.size(); ++i) {
+            bucket_[fill[prefix_hash(keys_[i].text.data())]++] = i;
+        }
+    }
+
+    void scan(std::string_view line, const Emit& emit) const override {
+        const char* const text = line.data();
+        for (size_t pos = min_length_ - 1; pos < line.size();) {
+            const size_t h = hash(text + pos + 1 - block_);
+            if (const uint32_t shift = shift_[h]) {
+                pos += shift;
+                continue;
+            }
+            const size_t start = pos + 1 - min_length_;
+            const size_t b = prefix_hash(text + start);
+            for (uint32_t i = bucket_start_[b]; i < bucket_start_[b + 1]; ++i) {
+                const EngineKey& key = keys_[bucket_[i]];
+                const size_t length = key.text.size();
+                if (length <= line.size() - start &&
+                    std::memcmp(text + start, key.text.data(), length) == 0) {
+                    emit(start + length - 1, key.id);
+                }
+            }
+            ++pos;
+        }
+    }
+
+private:
+    std::vector<EngineKey> keys_;
+    size_t min_length_;
+    size_t block_;
+    std::vector<uint32_t> shift_;
+    // Patrones agrupados por el hash de su prefijo de longitud mínima.
+    size_t bucket_mask_;
+    std::vector<uint32_t> bucket_start_;
+    std::vector<uint32_t> bucket_;
+    uint8_t symbol_[256]; // clase de cada byte, ya plegada a radix_
+    size_t radix_;
+
+    // Se calcula en cada salto 0, así que con prefijos de 8 bytes o más se
+    // leen solo dos palabras: los 8 primeros bytes y los 8 últimos.
+    size_t prefix_hash(const char* text) const {
+        uint64_t h;
+        if (min_length_ >= 8) {
+            uint64_t head, tail;
+            std::memcpy(&head, text, 8);
+            std::memcpy(&tail, text + min_length_ - 8, 8);
+            h = (head * 0x9E3779B97F4A7C15ull) ^ (tail * 0xC2B2AE3D27D4EB4Full);
+        } else {
+            h = 14695981039346656037ull; // FNV-1a
+            for (size_t i = 0; i < min_length_; ++i) {
+                h = (h ^ static_cast<unsigned char>(text[i])) * 1099511628211ull;
+            }
+        }
+        return static_cast<size_t>(h ^ (h >> 29)) & bucket_mask_;
+    }
+
+    size_t hash(const char* block) const {
+        size_t h = 0;
+        for (size_t i = 0; i < block_; ++i) {
+            h = h * radix_ + symbol_[static_cast<unsigned char>(block[i])];
+        }
+        return h;
+    }
+};
+
+} // namespace
+
+const char* engine_name(Engine engine) {
+    switch (engine) {
+        case Engine::Auto: return "auto";
+        case Engine::AhoCorasick: return "aho-corasick";
+        case Engine::Memmem: return "memmem";
+        case Engine::ShiftOr: return "shift-or";
+        case Engine::WuManber: return "wu-manber";
+    }
+    return "?";
+}
+
+Engine parse_engine(std::string_view name) {
+    for (Engine engine : {Engine::Auto, Engine::AhoCorasick, Engine::Memmem, Engine::ShiftOr,
+                           Engine::WuManber}) {
+        if (name == engine_name(engine)) return engine;
+    }
+    throw std::invalid_argument("Motor de búsqueda desconocido: " + std::string(name));
+}
+
+void DictionaryProfile::add(std::string_view pattern) {
+    const size_t length = pattern.size();
+    min_length = count == 0 ? length : std::min(min_length, length);
+    max_length = std::max(max_length, length);
+    total_length += length;
+    ++count;
+    for (unsigned char c : pattern) {
+        c = static_cast<unsigned char>(std::tolower(c));
+        alphabet += !seen_[c];
+        seen_[c] = true;
+    }
+}
+
+Engine choose_engine(const DictionaryProfile& profile) {
+    if (profile.count > 0 && profile.count <= kMemmemMaxPatterns) return Engine::Memmem;
+    if (profile.count > 0 && profile.total_length <= kShiftOrMaxBits) return Engine::ShiftOr;
+    if (profile.count > 0 && profile.count <= kWuManberMaxPatterns &&
+        profile.min_length >= kWuManberMinLength && profile.alphabet >= kWuManberMinAlphabet) {
+        return Engine::WuManber;
+    }
+    return Engine::AhoCorasick;
+}
+
+std::unique_ptr<LineSearcher> make_line_searcher(Engine engine,
+                                                 const std::vector<EngineKey>& keys) {
+    switch (engine) {
+        case Engine::Memmem: return std::make_unique<MemmemSearcher>(keys);
+        case Engine::ShiftOr: {
+            size_t bits = 0;
+            for (const EngineKey& key : keys) bits += key.text.size();
+            if (bits <= 64) return std::make_unique<ShiftOrSearcher<uint64_t>>(keys);
+            if (bits <= kShiftOrMaxBits) {
+                return std::make_unique<ShiftOrSearcher<unsigned __int128>>(keys);
+            }
+            throw std::invalid_argument("Los patrones suman más de " +
+                                        std::to_string(kShiftOrMaxBits) +
+                                        " caracteres: demasiado para shift-or");
+        }
+        case Engine::WuManber: return std::make_unique<WuManberSearcher>(keys);
+        case Engine::AhoCorasick: return nullptr;
+        case Engine::Auto: break;
+    }
+    throw std::invalid_argument("Motor de búsqueda no válido");
+}
+
+} // namespace ahocorasick
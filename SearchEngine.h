@@ -0,0 +1,72 @@
+#ifndef SEARCH_ENGINE_H
+#define SEARCH_ENGINE_H
+
+#include "Automaton.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ahocorasick {
+
+// Algoritmo con el que PatternMatcher recorre el texto. Todos dan las mismas
+// coincidencias; cambia solo el coste según la forma del diccionario.
+enum class Engine {
+    Auto,        // lo elige initialize() con choose_engine()
+    AhoCorasick, // el autómata: sirve para cualquier diccionario
+    Memmem,      // una búsqueda de subcadena (vectorizada en glibc) por patrón
+    ShiftOr,     // bit-paralelo; la suma de longitudes debe caber en 128 bits
+    WuManber,    // saltos por bloques; para patrones largos (al menos 2 caracteres)
+};
+
+const char* engine_name(Engine engine);
+// Inversa de engine_name(); lanza std::invalid_argument si no lo reconoce.
+Engine parse_engine(std::string_view name);
+
+// Patrón tal como lo ve un motor: normalizado con clean_text(), plegado a
+// minúsculas como hace el autómata, y con el ID que se emite.
+struct EngineKey {
+    std::string text;
+    PatternID id;
+};
+
+// Forma del diccionario (patrones distintos y no vacíos) en la que se basa
+// la elección automática del motor.
+struct DictionaryProfile {
+    size_t count = 0;
+    size_t min_length = 0;
+    size_t max_length = 0;
+    size_t total_length = 0;
+    size_t alphabet = 0; // símbolos distintos que aparecen en los patrones
+
+    // Acumula un patrón normalizado (sin plegar todavía).
+    void add(std::string_view pattern);
+
+private:
+    bool seen_[256] = {};
+};
+
+Engine choose_engine(const DictionaryProfile& profile);
+
+// Motor alternativo al autómata. Trabaja línea a línea sobre texto ya
+// normalizado y plegado, e informa de cada aparición con la posición de su
+// último carácter, igual que los estados finales del autómata.
+class LineSearcher {
+public:
+    using Emit = std::function<void(size_t end, PatternID id)>;
+
+    virtual ~LineSearcher() = default;
+    virtual void scan(std::string_view line, const Emit& emit) const = 0;
+};
+
+// nullptr para Engine::AhoCorasick, que no es un LineSearcher. Lanza
+// std::invalid_argument si el motor no admite esos patrones.
+std::unique_ptr<LineSearcher> make_line_searcher(Engine engine,
+                                                 const std::vector<EngineKey>& keys);
+
+} // namespace ahocorasick
+
+#endif // SEARCH_ENGINE_H
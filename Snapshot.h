@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ahocorasick {
+
+// Cabecera de la instantánea. Le siguen las secciones en el orden de
+// SnapshotLayout, cada una alineada a 8 bytes; todo son índices, así que el
+// archivo no depende de la dirección en que se proyecte.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t alphabet_size; // columnas de la tabla de transiciones
+    uint32_t flags;
+    uint64_t file_size;
+    uint64_t state_count;
+    uint64_t output_count;
+    uint64_t pattern_count;
+    uint64_t pattern_bytes;
+    uint64_t normalized_bytes;
+    uint64_t max_depth;
+    char normalization[256];
+};
+
+// Desplazamiento de cada sección dentro del archivo.
+struct SnapshotLayout {
+    size_t transitions, fail, output_link, depth, out_head, outputs;
+    size_t pattern_offsets, pattern_bytes, normalized_offsets, normalized_bytes;
+    size_t canonical, removed, flags, byte_class;
+    size_t end;
+};
+
+// Calcula las secciones a partir de los recuentos de la cabecera, según su
+// versión.
+SnapshotLayout snapshot_layout(const SnapshotHeader& header);
+
+} // namespace ahocorasick
+
+#endif // SNAPSHOT_H
@@ -1,7 +1,16 @@
 #include "ui.h"
 #include <iostream>
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        try {
+            return ui::run_command_line(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error crítico: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
     std::cout << "Sistema de Detección de Conceptos Clave en Literatura Educativa\n";
     std::cout << "Implementación del Autómata Aho-Corasick Mejorado\n";
     std::cout << "=============================================================\n";
@@ -1,8 +1,24 @@
 #include "catch.hpp"
+#include "../Corpus.h"
+#include "../InputSource.h"
+#include "../MatchStats.h"
 #include "../PatternMatcher.h"
+#include "../PatternPool.h"
+#include "../Pipeline.h"
+#include "../ResultWriter.h"
+#include "../Snapshot.h"
 #include "../ui.h"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <map>
 #include <cstdio>
+#include <cstring>
+#include <sstream>
+#ifdef AHOCORASICK_WITH_ZLIB
+#include <zlib.h>
+#endif
 
 TEST_CASE(trie_construction) {
     ahocorasick::PatternMatcher matcher;
@@ -31,3 +47,1025 @@ TEST_CASE(file_loading) {
     REQUIRE(patterns.size() == 2);
     REQUIRE(patterns[0] == "alpha");
 }
+
+TEST_CASE(pipeline_matches_search) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "ushers, and 2 his sh1eep!\nnothing here\n";
+    }
+    auto expected = matcher.search(text);
+
+    ahocorasick::PipelineOptions options;
+    options.block_size = 64;
+    options.matcher_threads = 3;
+    options.queue_capacity = 2;
+    ahocorasick::Pipeline pipeline(matcher, options);
+    std::istringstream input(text);
+    std::vector<ahocorasick::MatchResult> results;
+    size_t total = pipeline.run(input, [&](const ahocorasick::MatchResult& m) {
+        results.push_back(m);
+    });
+    REQUIRE(total == expected.size());
+    REQUIRE(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i].line == expected[i].line);
+        REQUIRE(results[i].column == expected[i].column);
+        REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+        REQUIRE(results[i].context == expected[i].context);
+        REQUIRE(results[i].offset == expected[i].offset);
+        REQUIRE(results[i].length == expected[i].length);
+    }
+
+    // Desde una fuente de bloques pequeños que cortan líneas por la mitad.
+    const char* fname = "tmp_pipeline.txt";
+    {
+        std::ofstream out(fname, std::ios::binary);
+        out << text;
+    }
+    ahocorasick::BlockReader reader(fname, 7);
+    std::vector<ahocorasick::MatchResult> from_source;
+    pipeline.run(reader, [&](const ahocorasick::MatchResult& m) { from_source.push_back(m); });
+    std::remove(fname);
+    REQUIRE(from_source.size() == expected.size());
+    for (size_t i = 0; i < from_source.size(); ++i) {
+        REQUIRE(from_source[i].line == expected[i].line);
+        REQUIRE(from_source[i].column == expected[i].column);
+        REQUIRE(from_source[i].offset == expected[i].offset);
+    }
+}
+
+TEST_CASE(scanner_pulls_matches_across_chunks) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    const std::string text = "ushers and his sheep\nnothing here\nthe end";
+    auto expected = matcher.search(text);
+
+    for (size_t chunk_size = 1; chunk_size <= 7; ++chunk_size) {
+        ahocorasick::Scanner scanner(matcher);
+        std::vector<ahocorasick::MatchResult> results;
+        ahocorasick::MatchResult match;
+        for (size_t pos = 0; pos < text.size(); pos += chunk_size) {
+            scanner.feed(std::string_view(text).substr(pos, chunk_size));
+            while (scanner.next(match)) results.push_back(match);
+        }
+        scanner.finish();
+        while (scanner.next(match)) results.push_back(match);
+
+        std::sort(results.begin(), results.end());
+        REQUIRE(results.size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            REQUIRE(results[i].line == expected[i].line);
+            REQUIRE(results[i].column == expected[i].column);
+            REQUIRE(results[i].context == expected[i].context);
+        }
+    }
+}
+
+TEST_CASE(block_reader_feeds_scanner) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"abracadabra", "cadabra", "bra", "a cab"});
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += "abracadabra, a cab" + std::string(i % 5, ' ') + " abracadabra\n";
+    }
+    const auto expected = matcher.search(text);
+    const char* fname = "tmp_block_reader.txt";
+    {
+        std::ofstream out(fname, std::ios::binary);
+        out << text;
+    }
+
+    // Bloques más cortos que el patrón más largo: muchas coincidencias
+    // empiezan en un bloque y terminan dos o tres bloques más allá.
+    for (size_t block_size : {1, 3, 4, 10}) {
+        ahocorasick::BlockReader reader(fname, block_size);
+        ahocorasick::Scanner scanner(matcher);
+        std::vector<ahocorasick::MatchResult> results;
+        auto sink = [&](const ahocorasick::MatchResult& m) { results.push_back(m); };
+        for (std::string_view block = reader.next(); !block.empty(); block = reader.next()) {
+            REQUIRE(block.size() <= block_size);
+            scanner.feed(block, sink);
+        }
+        scanner.finish(sink);
+        std::sort(results.begin(), results.end());
+
+        size_t straddling = 0;
+        REQUIRE(results.size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            REQUIRE(results[i].line == expected[i].line);
+            REQUIRE(results[i].column == expected[i].column);
+            REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+            REQUIRE(results[i].offset == expected[i].offset);
+            REQUIRE(results[i].context == expected[i].context);
+            const size_t last = results[i].offset + results[i].length - 1;
+            straddling += results[i].offset / block_size != last / block_size;
+        }
+        REQUIRE(straddling > 0);
+    }
+    std::remove(fname);
+}
+
+TEST_CASE(match_stats_merge_tree) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += "ushers and his sheep\nnothing here\n";
+    }
+    auto results = matcher.search(text);
+
+    ahocorasick::MatchStats expected(matcher.patterns().size(), 10);
+    std::vector<ahocorasick::MatchStats> shards(5, ahocorasick::MatchStats(4, 10));
+    for (size_t i = 0; i < results.size(); ++i) {
+        expected.add(results[i]);
+        shards[i % shards.size()].add(results[i]);
+    }
+    auto merged = ahocorasick::MatchStats::merge_tree(shards);
+    REQUIRE(merged.total() == results.size());
+    REQUIRE(merged.counts() == expected.counts());
+    REQUIRE(merged.histogram() == expected.histogram());
+    REQUIRE(merged.first_line() == 1);
+    REQUIRE(merged.last_line() == 100);
+
+    ahocorasick::PipelineOptions options;
+    options.block_size = 128;
+    options.matcher_threads = 4;
+    ahocorasick::Pipeline pipeline(matcher, options);
+    std::istringstream input(text);
+    ahocorasick::MatchStats pipeline_stats(matcher.patterns().size(), 10);
+    pipeline.run(input, [](const ahocorasick::MatchResult&) {}, pipeline_stats);
+    REQUIRE(pipeline_stats.counts() == expected.counts());
+    REQUIRE(pipeline_stats.histogram() == expected.histogram());
+}
+
+TEST_CASE(mapped_file_search) {
+    const char* fname = "tmp_text.txt";
+    const std::string content = "ushers and his sheep\n\tnothing here\n";
+    {
+        std::ofstream out(fname);
+        out << content;
+    }
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    std::vector<ahocorasick::MatchResult> results;
+    {
+        ahocorasick::MappedFile file(fname);
+        REQUIRE(file.mapped());
+        REQUIRE(file.view() == content);
+        results = matcher.search(file.view());
+    }
+    REQUIRE(ui::load_text_from_file(fname) == content);
+    std::remove(fname);
+    auto expected = matcher.search(content);
+    REQUIRE(results.size() == expected.size());
+    REQUIRE(results.back().line == 2);
+}
+
+TEST_CASE(scanner_offsets_and_bounded_window) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"abcd", "bc", "needle"});
+    auto results = matcher.search("x abcx\n12 ab-c, abcd");
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0].pattern == "bc");
+    REQUIRE(results[0].offset == 3);
+    REQUIRE(results[2].pattern == "bc");
+    REQUIRE(results[1].offset == 16);
+    REQUIRE(results[2].offset == 17);
+    REQUIRE(results[1].length == 4);
+    // La longitud cuenta también los bytes descartados dentro de la coincidencia.
+    auto spanning = matcher.search("a b2c");
+    REQUIRE(spanning.size() == 1);
+    REQUIRE(spanning[0].offset == 2);
+    REQUIRE(spanning[0].length == 3);
+
+    ahocorasick::Scanner scanner(matcher, 5);
+    std::string chunk(1 << 16, 'z');
+    chunk.replace(100, 6, "needle");
+    size_t found = 0;
+    size_t last_offset = 0;
+    for (int i = 0; i < 64; ++i) {
+        scanner.feed(chunk, [&](const ahocorasick::MatchResult& m) {
+            ++found;
+            last_offset = m.offset;
+            REQUIRE(m.context == "zneedlezzzz");
+        });
+    }
+    scanner.finish([&](const ahocorasick::MatchResult&) { ++found; });
+    REQUIRE(found == 64);
+    REQUIRE(last_offset == 63 * chunk.size() + 100);
+    REQUIRE(scanner.line() == 2);
+}
+
+TEST_CASE(corpus_scan_splits_large_files) {
+    namespace fs = std::filesystem;
+    const fs::path dir = "tmp_corpus";
+    fs::create_directories(dir / "sub");
+    std::string big;
+    for (int i = 0; i < 300; ++i) {
+        big += "line without terms\nushers and his sheep\n";
+    }
+    {
+        std::ofstream(dir / "big.txt") << big;
+        std::ofstream(dir / "sub" / "small.txt") << "she sells\nnothing";
+    }
+
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    ahocorasick::CorpusOptions options;
+    options.threads = 3;
+    options.chunk_size = 100;
+    ahocorasick::CorpusScanner corpus(matcher, options);
+    std::map<std::string, std::vector<ahocorasick::MatchResult>> found;
+    size_t total = corpus.run(dir.string(), [&](const std::string& path,
+                                                 const ahocorasick::MatchResult& m) {
+        found[path].push_back(m);
+    });
+    fs::remove_all(dir);
+
+    auto expected = matcher.search(big);
+    auto& got = found[(dir / "big.txt").string()];
+    std::sort(got.begin(), got.end());
+    REQUIRE(got.size() == expected.size());
+    for (size_t i = 0; i < got.size(); ++i) {
+        REQUIRE(got[i].line == expected[i].line);
+        REQUIRE(got[i].column == expected[i].column);
+        REQUIRE(got[i].offset == expected[i].offset);
+    }
+    REQUIRE(found[(dir / "sub" / "small.txt").string()].size() == 2);
+    REQUIRE(total == expected.size() + 2);
+}
+
+TEST_CASE(prefetch_reader_backends) {
+    const char* fname = "tmp_prefetch.txt";
+    std::string content;
+    for (int i = 0; i < 5000; ++i) {
+        content += "ushers and his sheep " + std::to_string(i) + "\n";
+    }
+    {
+        std::ofstream out(fname);
+        out << content;
+    }
+    for (bool io_uring : {true, false}) {
+        ahocorasick::PrefetchReader reader(fname, 4096, 3, io_uring);
+        if (!io_uring) REQUIRE(!reader.uses_io_uring());
+        std::string read;
+        for (std::string_view block = reader.next(); !block.empty(); block = reader.next()) {
+            read.append(block.data(), block.size());
+        }
+        REQUIRE(read == content);
+    }
+
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his"});
+    auto source = ahocorasick::open_block_source(fname);
+    const char* out_name = "tmp_prefetch_out.txt";
+    size_t total = 0;
+    {
+        ahocorasick::TextWriter writer(out_name);
+        total = ui::scan_stream(*source, matcher, 20, "", writer);
+        writer.finish();
+    }
+    const std::string written = ui::load_text_from_file(out_name);
+    std::remove(fname);
+    std::remove(out_name);
+    REQUIRE(total == matcher.search(content).size());
+    REQUIRE(static_cast<size_t>(std::count(written.begin(), written.end(), '\n')) == total);
+    REQUIRE(written.compare(0, 26, "1:2:she:ushers and his she") == 0);
+}
+
+TEST_CASE(decompressing_source) {
+    REQUIRE(ahocorasick::detect_compression("\x1f\x8b\x08") == ahocorasick::Compression::Gzip);
+    REQUIRE(ahocorasick::detect_compression("\x28\xb5\x2f\xfd") == ahocorasick::Compression::Zstd);
+    REQUIRE(ahocorasick::detect_compression("ushers") == ahocorasick::Compression::None);
+
+    std::string content;
+    for (int i = 0; i < 20000; ++i) {
+        content += "ushers and his sheep " + std::to_string(i) + "\n";
+    }
+    const char* fname = "tmp_compressed.txt";
+    {
+        std::ofstream out(fname, std::ios::binary);
+        out << content;
+    }
+    auto plain = ahocorasick::open_block_source(fname);
+    std::string read;
+    for (std::string_view block = plain->next(); !block.empty(); block = plain->next()) {
+        read.append(block.data(), block.size());
+    }
+    REQUIRE(read == content);
+
+#ifdef AHOCORASICK_WITH_ZLIB
+    std::string gz(compressBound(content.size()) + 64, '\0');
+    z_stream z{};
+    deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    z.next_in = reinterpret_cast<Bytef*>(&content[0]);
+    z.avail_in = static_cast<uInt>(content.size());
+    z.next_out = reinterpret_cast<Bytef*>(&gz[0]);
+    z.avail_out = static_cast<uInt>(gz.size());
+    deflate(&z, Z_FINISH);
+    gz.resize(z.total_out);
+    deflateEnd(&z);
+    {
+        // Dos miembros concatenados, como produce `cat a.gz b.gz`.
+        std::ofstream out(fname, std::ios::binary);
+        out << gz << gz;
+    }
+    auto source = ahocorasick::open_block_source(fname);
+    read.clear();
+    for (std::string_view block = source->next(); !block.empty(); block = source->next()) {
+        read.append(block.data(), block.size());
+    }
+    REQUIRE(read == content + content);
+
+    // El modo pipeline lee de la misma fuente y ve el texto descomprimido.
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"his sheep"});
+    ahocorasick::Pipeline pipeline(matcher);
+    auto compressed = ahocorasick::open_block_source(fname);
+    REQUIRE(pipeline.run(*compressed, [](const ahocorasick::MatchResult&) {}) == 40000);
+#else
+    {
+        std::ofstream out(fname, std::ios::binary);
+        out << "\x1f\x8b\x08" << content;
+    }
+    bool rejected = false;
+    try {
+        ahocorasick::open_block_source(fname);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    REQUIRE(rejected);
+#endif
+    std::remove(fname);
+}
+
+TEST_CASE(pattern_pool_bulk_loading) {
+    const char* fname = "tmp_pool.txt";
+    const size_t count = 150000;
+    {
+        std::ofstream out(fname);
+        for (size_t i = 0; i < count; ++i) {
+            out << "Term-" << i << "\n";
+            if (i % 1000 == 0) out << "\n";
+        }
+        out << "ushers";
+    }
+    auto pool = ahocorasick::PatternPool::load(fname);
+    std::remove(fname);
+    REQUIRE(pool.size() == count + 1);
+    REQUIRE(pool[0] == "Term-0");
+    REQUIRE(pool[count] == "ushers");
+
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize(std::move(pool));
+    REQUIRE(matcher.patterns().size() == count + 1);
+    REQUIRE(matcher.patterns()[42] == "Term-42");
+
+    std::vector<std::string> owned = {"Term-7", "", "ushers"};
+    ahocorasick::PatternMatcher moved;
+    moved.initialize(std::move(owned));
+    REQUIRE(owned.empty());
+    REQUIRE(moved.patterns().size() == 3);
+    REQUIRE(moved.patterns()[2] == "ushers");
+    REQUIRE(moved.search("Ushers").size() == 1);
+    // Todos los "Term-<n>" se normalizan a "term-": se emite uno por
+    // aparición, el canónico, y el resto quedan como alias suyos.
+    auto results = matcher.search("a term- and ushers");
+    REQUIRE(results.size() == 2);
+    REQUIRE(results.front().pattern_id == 0);
+    REQUIRE(matcher.canonical_id(42) == 0);
+    REQUIRE(matcher.aliases(42).size() == count);
+    REQUIRE(results.back().pattern == "ushers");
+    // La columna se calcula con la longitud normalizada ("term-"), no la original.
+    REQUIRE(results.front().column == 3);
+    REQUIRE(results.back().column == 13);
+}
+
+TEST_CASE(automaton_snapshot_roundtrip) {
+    const char* fname = "tmp_automaton.acs";
+    ahocorasick::PatternMatcher matcher(false, true);
+    matcher.initialize({"he", "She", "hers", "his", "Term-42"});
+    matcher.save(fname);
+
+    auto loaded = ahocorasick::PatternMatcher::load(fname);
+    REQUIRE(loaded.patterns().size() == 5);
+    REQUIRE(loaded.patterns()[4] == "Term-42");
+    REQUIRE(loaded.node_count() == matcher.node_count());
+    REQUIRE(loaded.clean_text("Ushers") == "Ushers");
+    const std::string text = "Ushers and his sheep\nthe term- end";
+    auto expected = matcher.search(text);
+    auto results = loaded.search(text);
+    REQUIRE(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i].pattern == expected[i].pattern);
+        REQUIRE(results[i].column == expected[i].column);
+        REQUIRE(results[i].offset == expected[i].offset);
+    }
+    // Las tablas proyectadas se copian al modificarlas.
+    loaded.add_patterns({"sheep"});
+    REQUIRE(loaded.search(text).size() == expected.size() + 1);
+    loaded.initialize({"end"});
+    REQUIRE(loaded.search(text).size() == 1);
+
+    // Una transición que apunta fuera de la tabla debe rechazarse al cargar.
+    std::string bytes;
+    {
+        std::ifstream in(fname, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    ahocorasick::SnapshotHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    bytes[ahocorasick::snapshot_layout(header).transitions] = '\x7f';
+    {
+        std::ofstream out(fname, std::ios::binary);
+        out << bytes;
+    }
+    bool rejected = false;
+    try {
+        ahocorasick::PatternMatcher::load(fname);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    std::remove(fname);
+    REQUIRE(rejected);
+}
+
+TEST_CASE(html_report_streams_matches) {
+    const char* fname = "tmp_report.html";
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "<x>"});
+    {
+        ahocorasick::HtmlReport report(fname, matcher.patterns());
+        ahocorasick::Scanner scanner(matcher);
+        auto sink = [&](const ahocorasick::MatchResult& match) { report.write("a&b.txt", match); };
+        scanner.feed("ushers\nshe saw x", sink);
+        scanner.finish(sink);
+        report.finish();
+        REQUIRE(report.stats().total() == 6);
+    }
+    std::ifstream in(fname);
+    const std::string html((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(fname);
+    REQUIRE(html.find("Total de coincidencias: 6") != std::string::npos);
+    REQUIRE(html.find("<li>she: 2 coincidencias</li>") != std::string::npos);
+    REQUIRE(html.find("<li>&lt;x&gt;: 1 coincidencias</li>") != std::string::npos);
+    REQUIRE(html.find("a&amp;b.txt, Línea 2") != std::string::npos);
+    REQUIRE(html.rfind("</html>\n") == html.size() - 8);
+}
+
+TEST_CASE(machine_readable_writers) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she"});
+    auto results = matcher.search("a \"she\", b2e\nhe");
+    REQUIRE(results.size() == 3);
+    auto read_file = [](const char* fname) {
+        std::ifstream in(fname, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::remove(fname);
+        return data;
+    };
+
+    {
+        ahocorasick::JsonLinesWriter jsonl("tmp_results.jsonl");
+        for (const auto& r : results) jsonl.write("x\"y.txt", r);
+        jsonl.finish();
+    }
+    std::string jsonl = read_file("tmp_results.jsonl");
+    REQUIRE(std::count(jsonl.begin(), jsonl.end(), '\n') == 3);
+    REQUIRE(jsonl.find("{\"doc\":\"x\\\"y.txt\",\"line\":1,\"column\":3,\"offset\":3,"
+                       "\"length\":3,\"pattern_id\":1,\"pattern\":\"she\",") == 0);
+
+    {
+        ahocorasick::CsvWriter csv("tmp_results.csv");
+        for (const auto& r : results) csv.write("a,b.txt", r);
+        csv.finish();
+    }
+    std::string csv = read_file("tmp_results.csv");
+    REQUIRE(csv.find("doc,line,column,offset,length,pattern_id,pattern,context\r\n") == 0);
+    REQUIRE(csv.find("\r\n\"a,b.txt\",2,1,13,2,0,he,he\r\n") != std::string::npos);
+
+    {
+        // "cero" no tiene coincidencias pero conserva su número.
+        ahocorasick::BinaryRecordWriter bin("tmp_results.bin");
+        bin.begin_document("cero");
+        bin.begin_document("uno");
+        bin.write("uno", results[0]);
+        bin.write("dos", results[2]);
+        bin.finish();
+        REQUIRE((bin.documents() == std::vector<std::string>{"cero", "uno", "dos"}));
+    }
+    const size_t record = ahocorasick::BinaryRecordWriter::kRecordSize;
+    std::string bin = read_file("tmp_results.bin");
+    const std::string second = bin.substr(record, record);
+    REQUIRE(second == std::string("\x02\0\0\0\0\0\0\0\x0d\0\0\0\0\0\0\0\x02\0\0\0\0\0\0\0", 24));
+    // Tabla de documentos y pie al final.
+    const std::string footer = bin.substr(bin.size() - record);
+    REQUIRE(footer.compare(0, 8, ahocorasick::BinaryRecordWriter::kTrailerMagic, 8) == 0);
+    const std::string table("\x04\0\0\0cero\x03\0\0\0uno\x03\0\0\0dos\0\0", 24);
+    REQUIRE(footer.compare(8, 16, std::string("\x18\0\0\0\0\0\0\0\x03\0\0\0\0\0\0\0", 16)) == 0);
+    REQUIRE(bin.size() == 2 * record + table.size() + record);
+    REQUIRE(bin.substr(2 * record, table.size()) == table);
+}
+
+TEST_CASE(incremental_pattern_insertion) {
+    // Alfabeto pequeño para que los sufijos se solapen mucho.
+    std::vector<std::string> all;
+    unsigned seed = 7;
+    for (int i = 0; i < 400; ++i) {
+        std::string pattern;
+        for (int len = 1 + static_cast<int>(seed % 6); len > 0; --len) {
+            seed = seed * 1103515245u + 12345u;
+            pattern += "abc-"[(seed >> 16) % 4];
+        }
+        all.push_back(pattern);
+    }
+    std::string text;
+    for (int i = 0; i < 3000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        text += "abc- x\n"[(seed >> 16) % 7];
+    }
+
+    ahocorasick::PatternMatcher full;
+    full.initialize(all);
+    auto expected = full.search(text);
+
+    ahocorasick::PatternMatcher incremental;
+    incremental.initialize(std::vector<std::string>(all.begin(), all.begin() + 50));
+    for (size_t i = 50; i < all.size(); i += 35) {
+        incremental.add_patterns(std::vector<std::string>(
+            all.begin() + i, all.begin() + std::min(all.size(), i + 35)));
+    }
+    REQUIRE(incremental.patterns().size() == all.size());
+    REQUIRE(incremental.node_count() == full.node_count());
+    auto results = incremental.search(text);
+    REQUIRE(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+        REQUIRE(results[i].offset == expected[i].offset);
+    }
+}
+
+TEST_CASE(pattern_removal_and_compaction) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "his", "sheep"});
+    matcher.set_compaction_threshold(0.5);
+    const std::string text = "ushers and his sheep";
+    const int nodes = matcher.node_count();
+
+    REQUIRE(matcher.remove_pattern(1));
+    REQUIRE(!matcher.remove_pattern(1));
+    REQUIRE(matcher.is_removed(1));
+    REQUIRE(!matcher.compaction_pending());
+    auto results = matcher.search(text);
+    REQUIRE(std::none_of(results.begin(), results.end(),
+                         [](const auto& m) { return m.pattern_id == 1; }));
+    REQUIRE(results.size() == 5);
+    matcher.save("tmp_removed.acs");
+    auto reloaded = ahocorasick::PatternMatcher::load("tmp_removed.acs");
+    std::remove("tmp_removed.acs");
+    REQUIRE(reloaded.search(text).size() == 5);
+
+    // Supera el umbral: se compacta en segundo plano y sigue filtrando mientras.
+    matcher.remove_pattern(4);
+    matcher.remove_pattern(2);
+    REQUIRE(matcher.compaction_pending());
+    matcher.add_patterns({"and"});
+    REQUIRE(matcher.search(text).size() == 4);
+    matcher.wait_for_compaction();
+    REQUIRE(!matcher.compaction_pending());
+    REQUIRE(matcher.node_count() < nodes);
+    REQUIRE(matcher.patterns().size() == 6);
+    REQUIRE(matcher.patterns()[4].empty());
+    results = matcher.search(text);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[1].pattern == "and");
+    REQUIRE(results[1].pattern_id == 5);
+    REQUIRE(results[2].pattern_id == 3);
+}
+
+TEST_CASE(duplicate_patterns_share_one_output) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"e-mail", "E-Mail", "mail", "email", "e-mail"});
+    REQUIRE(matcher.canonical_id(1) == 0);
+    REQUIRE(matcher.canonical_id(3) == 3);
+    REQUIRE((matcher.aliases(4) == std::vector<ahocorasick::PatternID>{0, 1, 4}));
+    size_t rejected = 0;
+    for (int accessor = 0; accessor < 4; ++accessor) {
+        try {
+            if (accessor == 0) matcher.is_removed(5);
+            if (accessor == 1) matcher.canonical_id(5);
+            if (accessor == 2) matcher.pattern_flags(5);
+            if (accessor == 3) matcher.aliases(5);
+        } catch (const std::out_of_range&) {
+            ++rejected;
+        }
+    }
+    REQUIRE(rejected == 4);
+    const std::string text = "send an E-mail or email";
+    auto results = matcher.search(text);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[0].pattern_id == 0);
+    REQUIRE(results[1].pattern_id == 2);
+
+    // Retirar el canónico pasa sus coincidencias al primer alias vivo, también
+    // tras guardar y cargar la instantánea.
+    matcher.set_compaction_threshold(1.0);
+    matcher.remove_pattern(0);
+    results = matcher.search(text);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[0].pattern_id == 1);
+    matcher.save("tmp_aliases.acs");
+    auto loaded = ahocorasick::PatternMatcher::load("tmp_aliases.acs");
+    std::remove("tmp_aliases.acs");
+    REQUIRE(loaded.is_removed(0));
+    REQUIRE(loaded.canonical_id(4) == 0);
+    REQUIRE(loaded.search(text)[0].pattern_id == 1);
+
+    matcher.add_patterns({"EMAIL"});
+    REQUIRE(matcher.canonical_id(5) == 3);
+    REQUIRE(matcher.search(text).size() == 4);
+
+    // Los alias añadidos después quedan en orden de ID, como en una
+    // construcción completa: al retirar el canónico se emite el primero vivo.
+    ahocorasick::PatternMatcher incremental;
+    incremental.initialize({"a", "x", "a"});
+    incremental.add_patterns({"a", "A"});
+    ahocorasick::PatternMatcher full;
+    full.initialize({"a", "x", "a", "a", "A"});
+    REQUIRE(incremental.aliases(0) == full.aliases(0));
+    for (ahocorasick::PatternID removed : {0, 2, 3}) {
+        incremental.remove_pattern(removed);
+        full.remove_pattern(removed);
+        REQUIRE(incremental.search("a")[0].pattern_id == full.search("a")[0].pattern_id);
+    }
+    REQUIRE(incremental.search("a")[0].pattern_id == 4);
+    incremental.set_pattern_flags(4, ahocorasick::kMatchCase);
+    full.set_pattern_flags(4, ahocorasick::kMatchCase);
+    REQUIRE(incremental.search("A")[0].pattern_id == full.search("A")[0].pattern_id);
+}
+
+TEST_CASE(lazy_dfa_matches_fail_walk) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "his", "hers", "usher", "a b", "sheep"});
+    std::string text;
+    for (int i = 0; i < 200; ++i) text += "ushers his sheep, a b she\nhehe ";
+    const auto expected = matcher.search(text);
+
+    // Una caché mínima obliga a desalojar filas constantemente.
+    for (size_t rows : {1, 4, 1024}) {
+        matcher.set_lazy_dfa(rows);
+        auto results = matcher.search(text);
+        REQUIRE(results.size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            REQUIRE(results[i].offset == expected[i].offset);
+            REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+        }
+        std::vector<ahocorasick::MatchResult> cleaned;
+        matcher.scan_cleaned(matcher.clean_text(text), 1, 20, cleaned);
+        REQUIRE(cleaned.size() == expected.size());
+    }
+
+    ahocorasick::Automaton automaton;
+    std::vector<ahocorasick::PatternID> canonical;
+    automaton.build(ahocorasick::PatternPool({"ab", "b", "bab"}), canonical);
+    ahocorasick::TransitionCache cache(automaton, 1000);
+    REQUIRE(cache.capacity() == 8);
+    ahocorasick::StateID state = ahocorasick::kRootState;
+    for (char c : std::string("ababab")) {
+        const int idx = ahocorasick::char_to_index(c);
+        const ahocorasick::StateID expected_state = automaton.step(state, idx);
+        state = cache.step(state, idx);
+        REQUIRE(state == expected_state);
+    }
+    REQUIRE(cache.misses() <= automaton.state_count());
+}
+
+TEST_CASE(engine_selection_keeps_search_contract) {
+    const std::string text = "Sh1eep and ushers\nshe said: SHE-EP\r\n hers";
+    for (bool case_sensitive : {false, true}) {
+        ahocorasick::PatternMatcher matcher(false, case_sensitive);
+        matcher.initialize({"sheep", "She", "she", "he"});
+        REQUIRE(matcher.engine() == ahocorasick::Engine::Memmem);
+        auto results = matcher.search(text, 6);
+        std::vector<ahocorasick::MatchResult> cleaned;
+        matcher.scan_cleaned(matcher.clean_text(text), 1, 6, cleaned);
+
+        matcher.set_engine(ahocorasick::Engine::AhoCorasick);
+        REQUIRE(matcher.engine() == ahocorasick::Engine::AhoCorasick);
+        const auto expected = matcher.search(text, 6);
+        std::vector<ahocorasick::MatchResult> expected_cleaned;
+        matcher.scan_cleaned(matcher.clean_text(text), 1, 6, expected_cleaned);
+        std::sort(cleaned.begin(), cleaned.end());
+        std::sort(expected_cleaned.begin(), expected_cleaned.end());
+
+        REQUIRE(results.size() == expected.size());
+        REQUIRE(cleaned.size() == expected_cleaned.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(results[i].line == expected[i].line);
+            REQUIRE(results[i].column == expected[i].column);
+            REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+            REQUIRE(results[i].context == expected[i].context);
+            REQUIRE(results[i].offset == expected[i].offset);
+            REQUIRE(results[i].length == expected[i].length);
+            REQUIRE(cleaned[i].offset == expected_cleaned[i].offset);
+            REQUIRE(cleaned[i].context == expected_cleaned[i].context);
+        }
+    }
+
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he"});
+    REQUIRE(matcher.engine() == ahocorasick::Engine::Memmem);
+    matcher.add_patterns({"she", "his", "hers"});
+    REQUIRE(matcher.engine() != ahocorasick::Engine::Memmem);
+    REQUIRE(ahocorasick::parse_engine("memmem") == ahocorasick::Engine::Memmem);
+}
+
+TEST_CASE(shift_or_engine_for_small_dictionaries) {
+    // 4 patrones en 64 bits y 6 que necesitan los 128.
+    const std::vector<std::vector<std::string>> dictionaries = {
+        {"he", "She", "his", "hers"},
+        {"he", "She", "his", "hers", "a-quite-long-blocked-phrase-with-many-letters",
+         "another long phrase that spills past sixty four bits"},
+    };
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += "ushers said his A-quite-long blocked phrase, with many letters!\n"
+                "another long phrase that spills past sixty four bits hehe\n";
+    }
+    for (const auto& patterns : dictionaries) {
+        ahocorasick::PatternMatcher matcher;
+        matcher.initialize(patterns);
+        REQUIRE(matcher.engine() == ahocorasick::Engine::ShiftOr);
+        const auto results = matcher.search(text);
+        matcher.set_engine(ahocorasick::Engine::AhoCorasick);
+        const auto expected = matcher.search(text);
+        REQUIRE(results.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(results[i].column == expected[i].column);
+            REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+            REQUIRE(results[i].offset == expected[i].offset);
+        }
+    }
+
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({std::string(70, 'a'), std::string(70, 'b')});
+    bool rejected = false;
+    try {
+        matcher.set_engine(ahocorasick::Engine::ShiftOr);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    REQUIRE(rejected);
+    REQUIRE(matcher.engine() == ahocorasick::Engine::Memmem);
+    REQUIRE(matcher.search(std::string(71, 'a')).size() == 2);
+    REQUIRE(matcher.engine() == ahocorasick::Engine::Memmem);
+    REQUIRE(matcher.search(std::string(71, 'a')).size() == 2);
+}
+
+TEST_CASE(wu_manber_engine_for_long_patterns) {
+    std::vector<std::string> patterns;
+    for (int i = 0; i < 300; ++i) {
+        patterns.push_back("phrase number " + std::string(1, char('a' + i % 26)) +
+                           std::string(1, char('a' + i / 26)) + " of the list");
+    }
+    patterns.push_back("Phrase Number AB of the list"); // alias de "phrase number ab..."
+    patterns.push_back("another rather long phrase");
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+        text += "the phrase number ab of the list and phrase number zk of the list\n"
+                "nothing to see here, another rather long phrase number qc of the list\n";
+    }
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize(patterns);
+    REQUIRE(matcher.engine() == ahocorasick::Engine::WuManber);
+    const auto results = matcher.search(text);
+    matcher.set_engine(ahocorasick::Engine::AhoCorasick);
+    const auto expected = matcher.search(text);
+    REQUIRE(expected.size() == 160);
+    REQUIRE(results.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        REQUIRE(results[i].line == expected[i].line);
+        REQUIRE(results[i].column == expected[i].column);
+        REQUIRE(results[i].pattern_id == expected[i].pattern_id);
+        REQUIRE(results[i].length == expected[i].length);
+    }
+
+    matcher.initialize({"ab", "abc", "bcd", "zz", "a-b"});
+    matcher.set_engine(ahocorasick::Engine::WuManber);
+    REQUIRE(matcher.search("abcd a-bzz").size() == 5);
+
+    // Con bytes crudos los bloques de dígitos y puntuación tienen sus propias
+    // clases en vez de caer todos en la de 'a'.
+    std::vector<std::string> codes;
+    for (int i = 0; i < 400; ++i) codes.push_back("#" + std::to_string(100000 + i * 7) + "/x");
+    std::string log;
+    for (int i = 0; i < 2000; ++i) log += "id #" + std::to_string(100000 + i) + "/x; ";
+    ahocorasick::PatternMatcher raw;
+    raw.set_alphabet(ahocorasick::Alphabet::Bytes);
+    raw.initialize(codes);
+    REQUIRE(raw.engine() == ahocorasick::Engine::WuManber);
+    const auto hits = raw.search(log);
+    raw.set_engine(ahocorasick::Engine::AhoCorasick);
+    const auto reference = raw.search(log);
+    REQUIRE(reference.size() == 286);
+    REQUIRE(hits.size() == reference.size());
+    for (size_t i = 0; i < hits.size(); ++i) {
+        REQUIRE(hits[i].offset == reference[i].offset);
+        REQUIRE(hits[i].pattern_id == reference[i].pattern_id);
+    }
+    // Con un alfabeto de cuatro letras los saltos serían casi siempre 0.
+    std::vector<std::string> reads;
+    uint32_t seed = 11;
+    for (int i = 0; i < 64; ++i) {
+        std::string read;
+        for (int j = 0; j < 10; ++j) {
+            seed = seed * 1103515245u + 12345u;
+            read += "acgt"[(seed >> 16) % 4];
+        }
+        reads.push_back(read);
+    }
+    ahocorasick::PatternMatcher dna;
+    dna.initialize(reads);
+    REQUIRE(dna.engine() == ahocorasick::Engine::AhoCorasick);
+}
+
+TEST_CASE(case_sensitivity_toggles_without_rebuild) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"He", "SHE", "hers"});
+    const int nodes = matcher.node_count();
+    const std::string text = "UsHErs said He";
+    REQUIRE(matcher.search(text)[0].context == "ushers said he");
+
+    matcher.set_case_sensitive(true);
+    REQUIRE(matcher.case_sensitive());
+    REQUIRE(matcher.node_count() == nodes);
+    REQUIRE(matcher.clean_text("He-3") == "He-");
+    // Ahora todos los patrones exigen el caso exacto: solo queda "He".
+    auto results = matcher.search(text);
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].column == 13);
+    REQUIRE(results[0].context == " He");
+
+    matcher.save("tmp_case.acs");
+    auto loaded = ahocorasick::PatternMatcher::load("tmp_case.acs");
+    std::remove("tmp_case.acs");
+    REQUIRE(loaded.case_sensitive());
+    loaded.set_case_sensitive(false);
+    REQUIRE(loaded.search(text)[0].context == "ushers said he");
+    REQUIRE(loaded.search(text).size() == 4);
+}
+
+TEST_CASE(per_pattern_case_flags) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"NASA", "nasa", "IBM", "ibm-x", "Ibm"});
+    matcher.set_pattern_flags(0, ahocorasick::kMatchCase);
+    matcher.set_pattern_flags(2, ahocorasick::kMatchCase);
+    REQUIRE(matcher.canonical_id(1) == 0);
+    const std::string text = "NASA and Nasa; ibm-X, IBM\nnasa";
+
+    // Un solo recorrido: cada aparición se emite con el primer patrón del
+    // grupo que la acepta, y "IBM" solo con el caso exacto.
+    for (auto engine : {ahocorasick::Engine::AhoCorasick, ahocorasick::Engine::Memmem}) {
+        matcher.set_engine(engine);
+        auto results = matcher.search(text);
+        std::vector<ahocorasick::PatternID> ids;
+        for (const auto& match : results) ids.push_back(match.pattern_id);
+        REQUIRE((ids == std::vector<ahocorasick::PatternID>{0, 1, 3, 4, 2, 1}));
+        REQUIRE(results[1].context == " nasa ibm-x ibm");
+    }
+
+    std::vector<ahocorasick::MatchResult> cleaned;
+    matcher.scan_cleaned(matcher.clean_text(text), 1, 20, cleaned);
+    REQUIRE(cleaned.size() == 6);
+
+    matcher.save("tmp_flags.acs");
+    auto loaded = ahocorasick::PatternMatcher::load("tmp_flags.acs");
+    std::remove("tmp_flags.acs");
+    REQUIRE(loaded.pattern_flags(0) == ahocorasick::kMatchCase);
+    REQUIRE(loaded.search(text).size() == 6);
+    loaded.set_pattern_flags(2, 0);
+    REQUIRE(loaded.search(text).size() == 6);
+    REQUIRE(loaded.search(text)[2].pattern_id == 2);
+}
+
+TEST_CASE(word_boundary_flags) {
+    ahocorasick::PatternMatcher matcher;
+    matcher.initialize({"he", "she", "hers", "cat"});
+    matcher.set_pattern_flags(0, ahocorasick::kWholeWord);
+    matcher.set_pattern_flags(3, ahocorasick::kWordStart);
+    REQUIRE(matcher.uses_word_boundaries());
+    // El '1' se descarta al normalizar, pero sigue siendo parte de la palabra.
+    const std::string text = "ushers said he, he1 and 'he'\ncats concat he-he";
+
+    std::vector<std::vector<ahocorasick::MatchResult>> runs;
+    for (auto engine : {ahocorasick::Engine::AhoCorasick, ahocorasick::Engine::Memmem,
+                        ahocorasick::Engine::ShiftOr}) {
+        matcher.set_engine(engine);
+        runs.push_back(matcher.search(text));
+    }
+    ahocorasick::PipelineOptions options;
+    options.block_size = 16;
+    options.matcher_threads = 2;
+    ahocorasick::Pipeline pipeline(matcher, options);
+    std::istringstream input(text);
+    runs.emplace_back();
+    pipeline.run(input, [&](const ahocorasick::MatchResult& m) { runs.back().push_back(m); });
+
+    for (const auto& results : runs) {
+        std::vector<ahocorasick::PatternID> ids;
+        for (const auto& match : results) ids.push_back(match.pattern_id);
+        REQUIRE((ids == std::vector<ahocorasick::PatternID>{1, 2, 0, 0, 3, 0, 0}));
+        REQUIRE(results[2].offset == 12);
+        REQUIRE(results[3].offset == 25);
+        REQUIRE(results[4].offset == 29);
+    }
+
+    matcher.save("tmp_words.acs");
+    auto loaded = ahocorasick::PatternMatcher::load("tmp_words.acs");
+    std::remove("tmp_words.acs");
+    REQUIRE(loaded.pattern_flags(0) == ahocorasick::kWholeWord);
+    REQUIRE(loaded.search(text).size() == 7);
+    loaded.set_pattern_flags(0, 0);
+    loaded.set_pattern_flags(3, 0);
+    REQUIRE(!loaded.uses_word_boundaries());
+    REQUIRE(loaded.search(text).size() == 10);
+}
+
+TEST_CASE(raw_byte_alphabet) {
+    const std::string nul_pattern("n\0l", 3);
+    ahocorasick::PatternMatcher matcher;
+    matcher.set_alphabet(ahocorasick::Alphabet::Bytes);
+    matcher.initialize({"C++17", "café", "ERR-42", "a.b", nul_pattern});
+    const std::string text = "Use C++17 or c++20; café CAFÉ\nERR-42 at a.b, err-421 axb\n" +
+                             nul_pattern + "\n";
+    REQUIRE(matcher.clean_text(text) == text);
+
+    auto lower = [](std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    };
+    // Nada se descarta: offset y length se refieren al texto tal cual, y la
+    // columna cuenta bytes.
+    auto check = [&](const std::vector<ahocorasick::MatchResult>& results) {
+        std::vector<ahocorasick::PatternID> ids;
+        for (const auto& match : results) {
+            ids.push_back(match.pattern_id);
+            REQUIRE(match.length == match.pattern.size());
+            REQUIRE(lower(text.substr(match.offset, match.length)) == lower(match.pattern));
+        }
+        REQUIRE((ids == std::vector<ahocorasick::PatternID>{0, 1, 2, 3, 2, 4}));
+        REQUIRE(results[1].column == 21);
+        REQUIRE(results[4].column == 16);
+    };
+    for (auto engine : {ahocorasick::Engine::AhoCorasick, ahocorasick::Engine::Memmem,
+                        ahocorasick::Engine::ShiftOr, ahocorasick::Engine::WuManber}) {
+        matcher.set_engine(engine);
+        check(matcher.search(text));
+    }
+    matcher.set_engine(ahocorasick::Engine::AhoCorasick);
+    std::vector<ahocorasick::MatchResult> cleaned;
+    matcher.scan_cleaned(text, 1, 20, cleaned);
+    std::sort(cleaned.begin(), cleaned.end());
+    check(cleaned);
+    ahocorasick::PipelineOptions options;
+    options.block_size = 16;
+    ahocorasick::Pipeline pipeline(matcher, options);
+    std::istringstream input(text);
+    std::vector<ahocorasick::MatchResult> piped;
+    pipeline.run(input, [&](const ahocorasick::MatchResult& m) { piped.push_back(m); });
+    check(piped);
+
+    // Bytes nuevos al añadir patrones: las filas del autómata se ensanchan.
+    matcher.add_patterns({"20;", "CAFÉ"});
+    auto results = matcher.search(text);
+    REQUIRE(results.size() == 8);
+    matcher.set_lazy_dfa(4);
+    REQUIRE(matcher.search(text).size() == 8);
+
+    matcher.save("tmp_bytes.acs");
+    auto loaded = ahocorasick::PatternMatcher::load("tmp_bytes.acs");
+    std::remove("tmp_bytes.acs");
+    REQUIRE(loaded.alphabet() == ahocorasick::Alphabet::Bytes);
+    results = loaded.search(text);
+    REQUIRE(results.size() == 8);
+    REQUIRE(results[1].pattern_id == 5);
+    REQUIRE(results[3].pattern_id == 6);
+
+    loaded.set_alphabet(ahocorasick::Alphabet::Letters);
+    REQUIRE(loaded.clean_text("C++17") == "c");
+    // Con letras "C++17" se queda en "c", "20;" en nada y "CAFÉ" vuelve a
+    // ser alias de "café"; offset y length siguen abarcando lo descartado.
+    results = loaded.search(text);
+    std::vector<ahocorasick::PatternID> ids;
+    std::vector<size_t> offsets;
+    for (const auto& match : results) {
+        ids.push_back(match.pattern_id);
+        offsets.push_back(match.offset);
+    }
+    REQUIRE((ids == std::vector<ahocorasick::PatternID>{0, 0, 0, 1, 0, 1, 2, 3, 2, 4}));
+    REQUIRE((offsets == std::vector<size_t>{4, 13, 20, 20, 26, 26, 32, 42, 47, 59}));
+    REQUIRE(results[3].length == 3);
+    REQUIRE(results[9].length == 3);
+}
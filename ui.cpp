@@ -1,39 +1,43 @@
 #include "ui.h"
 
+#include "Corpus.h"
+#include "Pipeline.h"
+#include "ResultWriter.h"
+
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
-#include <sstream>
-#include <unordered_map>
+#include <memory>
 
 namespace ui {
 
 void generate_summary(const std::vector<ahocorasick::MatchResult>& results,
-                      const std::vector<std::string>& patterns) {
-    if (results.empty()) {
-        std::cout << "No se encontraron coincidencias para generar resumen.\n";
-        return;
+                      const ahocorasick::PatternPool& patterns) {
+    ahocorasick::MatchStats stats(patterns.size());
+    for (const auto& r : results) {
+        stats.add(r);
     }
+    generate_summary(stats, patterns);
+}
 
-    std::unordered_map<ahocorasick::PatternID, size_t> pattern_counts;
-    for (const auto& r : results) {
-        pattern_counts[r.pattern_id]++;
+void generate_summary(const ahocorasick::MatchStats& stats,
+                      const ahocorasick::PatternPool& patterns) {
+    if (stats.empty()) {
+        std::cout << "No se encontraron coincidencias para generar resumen.\n";
+        return;
     }
 
     std::cout << "\n=== RESUMEN ESTADÍSTICO ===\n";
-    std::cout << "Total de coincidencias: " << results.size() << "\n";
+    std::cout << "Total de coincidencias: " << stats.total() << "\n";
     std::cout << "Coincidencias por patrón:\n";
-    for (const auto& kv : pattern_counts) {
-        std::cout << " - " << std::setw(30) << std::left << patterns[kv.first]
-                  << ": " << kv.second << " coincidencias\n";
-    }
-    if (!results.empty()) {
-        size_t min_line = results.front().line;
-        size_t max_line = results.back().line;
-        std::cout << "\nDistribución desde línea " << min_line << " hasta "
-                  << max_line << "\n";
+    for (ahocorasick::PatternID id = 0; id < stats.counts().size(); ++id) {
+        if (stats.counts()[id] == 0) continue;
+        std::cout << " - " << std::setw(30) << std::left << patterns[id]
+                  << ": " << stats.counts()[id] << " coincidencias\n";
     }
+    std::cout << "\nDistribución desde línea " << stats.first_line() << " hasta "
+              << stats.last_line() << "\n";
 }
 
 void display_results(const std::vector<ahocorasick::MatchResult>& results,
@@ -56,49 +60,24 @@ void display_results(const std::vector<ahocorasick::MatchResult>& results,
 }
 
 void export_to_html(const std::vector<ahocorasick::MatchResult>& results,
-                    const std::vector<std::string>& patterns,
+                    const ahocorasick::PatternPool& patterns,
                     const std::string& output_path) {
-    std::ofstream out_file(output_path);
-    if (!out_file) {
-        throw std::runtime_error("No se pudo abrir el archivo para escritura");
-    }
-
-    out_file << "<!DOCTYPE html>\n<html lang='es'>\n<head>\n"
-             << "<meta charset='UTF-8'>\n"
-             << "<title>Resultados de Análisis</title>\n"
-             << "<style>\n"
-             << "body { font-family: Arial, sans-serif; line-height: 1.6; }\n"
-             << ".match { margin-bottom: 15px; border-left: 3px solid #3498db; padding-left: 10px; }\n"
-             << ".pattern { font-weight: bold; color: #e74c3c; }\n"
-             << ".context { color: #7f8c8d; font-style: italic; }\n"
-             << ".summary { background-color: #f9f9f9; padding: 15px; margin-bottom: 20px; }\n"
-             << "</style>\n</head>\n<body>\n"
-             << "<h1>Resultados de Análisis de Texto</h1>\n"
-             << "<div class='summary'>\n"
-             << "<h2>Resumen</h2>\n"
-             << "<p>Total de coincidencias: " << results.size() << "</p>\n";
-
-    std::unordered_map<ahocorasick::PatternID, size_t> pattern_counts;
+    ahocorasick::MatchStats stats(patterns.size());
     for (const auto& r : results) {
-        pattern_counts[r.pattern_id]++;
+        stats.add(r);
     }
+    export_to_html(results, stats, patterns, output_path);
+}
 
-    out_file << "<h3>Coincidencias por patrón:</h3>\n<ul>\n";
-    for (const auto& kv : pattern_counts) {
-        out_file << "<li>" << patterns[kv.first] << ": " << kv.second << " coincidencias</li>\n";
-    }
-    out_file << "</ul>\n</div>\n";
-
-    out_file << "<h2>Detalles de Coincidencias</h2>\n";
+void export_to_html(const std::vector<ahocorasick::MatchResult>& results,
+                    const ahocorasick::MatchStats& stats,
+                    const ahocorasick::PatternPool& patterns,
+                    const std::string& output_path) {
+    ahocorasick::HtmlReport report(output_path, patterns);
     for (const auto& result : results) {
-        out_file << "<div class='match'>\n"
-                 << "<p><strong>Línea " << result.line << ", Columna " << result.column << ":</strong> "
-                 << "Patrón: <span class='pattern'>" << result.pattern << "</span></p>\n"
-                 << "<p class='context'>Contexto: \"" << result.context << "\"</p>\n"
-                 << "</div>\n";
+        report.write("", result);
     }
-
-    out_file << "</body>\n</html>\n";
+    report.finish(stats);
     std::cout << "Resultados exportados a " << output_path << "\n";
 }
 
@@ -121,21 +100,212 @@ std::vector<std::string> load_patterns_from_file(const std::string& file_path) {
 }
 
 std::string load_text_from_file(const std::string& file_path) {
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("No se pudo abrir el archivo de texto: " + file_path);
+    ahocorasick::MappedFile file(file_path);
+    return std::string(file.view());
+}
+
+namespace {
+
+void print_usage(std::ostream& out) {
+    out << "Uso: proyecto -p <patrones.txt> [opciones] [archivo...]\n"
+        << "     proyecto -a <automata.acs> [opciones] [archivo...]\n"
+        << "Sin archivos (o con \"-\") se lee la entrada estándar.\n"
+        << "  -p <archivo>  archivo de patrones, uno por línea\n"
+        << "  -a <archivo>  cargar un autómata compilado con -o\n"
+        << "  -o <archivo>  guardar el autómata compilado; sin archivos de\n"
+        << "                entrada solo se compila\n"
+        << "  -c            distinguir mayúsculas y minúsculas\n"
+        << "  -w            solo coincidencias de palabra completa\n"
+        << "  -b            buscar sobre los bytes originales, sin normalizar\n"
+        << "  -C <n>        tamaño del contexto (por defecto 20)\n"
+        << "  -j <n>        usar el modo pipeline con n hilos de búsqueda\n"
+        << "  -e <motor>    motor de búsqueda con -j: auto (por defecto),\n"
+        << "                aho-corasick, memmem, shift-or o wu-manber\n"
+        << "  -L <n>        DFA perezoso con una caché de n filas de transiciones\n"
+        << "  -r            recorrer directorios recursivamente en paralelo\n"
+        << "  -f <formato>  formato de salida: texto (por defecto), html, jsonl,\n"
+        << "                csv o bin (registros binarios de 24 bytes)\n"
+        << "  -h            mostrar esta ayuda\n"
+        << "Sin argumentos se abre el menú interactivo.\n";
+}
+
+} // namespace
+
+size_t scan_stream(ahocorasick::BlockSource& reader,
+                   const ahocorasick::PatternMatcher& matcher,
+                   size_t context_size, std::string_view document,
+                   ahocorasick::ResultWriter& writer) {
+    ahocorasick::Scanner scanner(matcher, context_size);
+    size_t total = 0;
+    auto sink = [&](const ahocorasick::MatchResult& match) {
+        writer.write(document, match);
+        ++total;
+    };
+    for (std::string_view block = reader.next(); !block.empty(); block = reader.next()) {
+        scanner.feed(block, sink);
     }
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    return content;
+    scanner.finish(sink);
+    return total;
+}
+
+int run_command_line(int argc, char* argv[]) {
+    std::string patterns_path;
+    std::string automaton_path;
+    std::string output_path;
+    bool case_sensitive = false;
+    bool whole_words = false;
+    bool raw_bytes = false;
+    size_t context_size = 20;
+    size_t threads = 0;
+    size_t lazy_rows = 0;
+    ahocorasick::Engine engine = ahocorasick::Engine::Auto;
+    bool recursive = false;
+    std::string format = "texto";
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            print_usage(std::cout);
+            return 0;
+        } else if (arg == "-p" && has_value) {
+            patterns_path = argv[++i];
+        } else if (arg == "-a" && has_value) {
+            automaton_path = argv[++i];
+        } else if (arg == "-o" && has_value) {
+            output_path = argv[++i];
+        } else if (arg == "-c") {
+            case_sensitive = true;
+        } else if (arg == "-w") {
+            whole_words = true;
+        } else if (arg == "-b") {
+            raw_bytes = true;
+        } else if (arg == "-C" && has_value) {
+            context_size = std::stoul(argv[++i]);
+        } else if (arg == "-j" && has_value) {
+            threads = std::stoul(argv[++i]);
+        } else if (arg == "-e" && has_value) {
+            try {
+                engine = ahocorasick::parse_engine(argv[++i]);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << e.what() << "\n";
+                print_usage(std::cerr);
+                return 1;
+            }
+        } else if (arg == "-L" && has_value) {
+            lazy_rows = std::stoul(argv[++i]);
+        } else if (arg == "-r") {
+            recursive = true;
+        } else if (arg == "-f" && has_value) {
+            format = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Opción no válida: " << arg << "\n";
+            print_usage(std::cerr);
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (patterns_path.empty() == automaton_path.empty()) {
+        std::cerr << "Debe indicar el archivo de patrones con -p o un autómata con -a\n";
+        print_usage(std::cerr);
+        return 1;
+    }
+
+    ahocorasick::PatternMatcher matcher(false, case_sensitive);
+    if (raw_bytes) matcher.set_alphabet(ahocorasick::Alphabet::Bytes);
+    if (automaton_path.empty()) {
+        matcher.initialize(ahocorasick::PatternPool::load(patterns_path));
+    } else {
+        matcher = ahocorasick::PatternMatcher::load(automaton_path);
+        if (case_sensitive) matcher.set_case_sensitive(true);
+        if (raw_bytes) matcher.set_alphabet(ahocorasick::Alphabet::Bytes);
+    }
+    if (whole_words) {
+        for (ahocorasick::PatternID id = 0; id < matcher.patterns().size(); ++id) {
+            matcher.set_pattern_flags(id, matcher.pattern_flags(id) | ahocorasick::kWholeWord);
+        }
+    }
+    matcher.set_lazy_dfa(lazy_rows);
+    matcher.set_engine(engine);
+    if (!output_path.empty()) {
+        matcher.save(output_path);
+        if (inputs.empty()) return 0;
+    }
+    if (inputs.empty()) inputs.push_back("-");
+
+    std::ios::sync_with_stdio(false);
+    std::unique_ptr<ahocorasick::ResultWriter> writer;
+    if (format == "texto") {
+        writer.reset(new ahocorasick::TextWriter("-"));
+    } else if (format == "html") {
+        writer.reset(new ahocorasick::HtmlReport("-", matcher.patterns()));
+    } else if (format == "jsonl") {
+        writer.reset(new ahocorasick::JsonLinesWriter("-"));
+    } else if (format == "csv") {
+        writer.reset(new ahocorasick::CsvWriter("-"));
+    } else if (format == "bin") {
+        writer.reset(new ahocorasick::BinaryRecordWriter("-"));
+    } else {
+        std::cerr << "Formato de salida no válido: " << format << "\n";
+        print_usage(std::cerr);
+        return 1;
+    }
+
+    if (recursive) {
+        ahocorasick::CorpusOptions options;
+        options.threads = threads;
+        options.context_size = context_size;
+        ahocorasick::CorpusScanner corpus(matcher, options);
+        for (const auto& input : inputs) {
+            const std::string root = input == "-" ? "." : input;
+            for (const auto& path : ahocorasick::CorpusScanner::list_files(root)) {
+                writer->begin_document(path);
+            }
+            corpus.run(root,
+                       [&](const std::string& path, const ahocorasick::MatchResult& match) {
+                           writer->write(path, match);
+                       });
+        }
+        writer->finish();
+        return 0;
+    }
+    for (const auto& input : inputs) {
+        // Los registros binarios necesitan el nombre aunque haya un solo archivo.
+        const std::string document = inputs.size() > 1 || format == "bin" ? input : "";
+        writer->begin_document(document);
+        if (threads > 0) {
+            ahocorasick::PipelineOptions options;
+            options.matcher_threads = threads;
+            options.context_size = context_size;
+            ahocorasick::Pipeline pipeline(matcher, options);
+            // Misma fuente que el modo secuencial, así que también descomprime.
+            auto reader = ahocorasick::open_block_source(input);
+            pipeline.run(*reader, [&](const ahocorasick::MatchResult& match) {
+                writer->write(document, match);
+            });
+        } else {
+            auto reader = ahocorasick::open_block_source(input);
+            scan_stream(*reader, matcher, context_size, document, *writer);
+        }
+    }
+    writer->finish();
+    return 0;
 }
 
 void interactive_menu() {
     bool verbose = true;
     bool case_sensitive = false;
     ahocorasick::PatternMatcher matcher(verbose, case_sensitive);
-    std::vector<std::string> patterns;
     std::string text;
+    // Los archivos se proyectan en memoria; text solo guarda el texto escrito.
+    std::unique_ptr<ahocorasick::MappedFile> text_file;
+    auto current_text = [&]() -> std::string_view {
+        return text_file ? text_file->view() : std::string_view(text);
+    };
     std::vector<ahocorasick::MatchResult> last_results;
+    ahocorasick::MatchStats last_stats;
     size_t context_size = 20;
 
     auto print_status = [&]() {
@@ -143,7 +313,7 @@ void interactive_menu() {
         std::cout << "Modo verboso: " << (verbose ? "ON" : "OFF") << "\n";
         std::cout << "Sensibilidad a mayúsculas: " << (case_sensitive ? "ON" : "OFF") << "\n";
         std::cout << "Patrones cargados: " << matcher.patterns().size() << "\n";
-        std::cout << "Tamaño del texto: " << text.size() << " caracteres\n";
+        std::cout << "Tamaño del texto: " << current_text().size() << " caracteres\n";
         std::cout << "Tamaño del contexto: " << context_size << " caracteres\n";
         std::cout << "Última búsqueda: " << last_results.size() << " coincidencias\n\n";
     };
@@ -179,12 +349,11 @@ void interactive_menu() {
                     std::cout << "Ingrese la ruta del archivo de patrones: ";
                     std::string path;
                     std::getline(std::cin, path);
-                    patterns = load_patterns_from_file(path);
-                    matcher.initialize(patterns);
+                    matcher.initialize(ahocorasick::PatternPool::load(path));
                     break;
                 }
                 case 2: {
-                    patterns.clear();
+                    std::vector<std::string> patterns;
                     std::cout << "Ingrese los patrones (línea vacía para terminar):\n";
                     std::string line;
                     while (std::getline(std::cin, line) && !line.empty()) {
@@ -194,19 +363,21 @@ void interactive_menu() {
                         std::cout << "No se ingresaron patrones.\n";
                         continue;
                     }
-                    matcher.initialize(patterns);
+                    matcher.initialize(std::move(patterns));
                     break;
                 }
                 case 3: {
                     std::cout << "Ingrese la ruta del archivo de texto: ";
                     std::string path;
                     std::getline(std::cin, path);
-                    text = load_text_from_file(path);
-                    std::cout << "Texto cargado (" << text.size() << " caracteres)\n";
+                    text_file.reset(new ahocorasick::MappedFile(path));
+                    text.clear();
+                    std::cout << "Texto cargado (" << text_file->size() << " caracteres)\n";
                     break;
                 }
                 case 4: {
                     std::cout << "Ingrese el texto (escriba 'FIN' en una línea para terminar):\n";
+                    text_file.reset();
                     text.clear();
                     std::string line;
                     while (std::getline(std::cin, line)) {
@@ -223,24 +394,29 @@ void interactive_menu() {
                               << "Opción: ";
                     int opt;
                     std::cin >> opt;
+                    // Ninguna de estas opciones obliga a reconstruir el autómata.
                     if (opt == 1) {
                         verbose = !verbose;
+                        matcher.set_verbose(verbose);
                     } else if (opt == 2) {
                         case_sensitive = !case_sensitive;
+                        matcher.set_case_sensitive(case_sensitive);
                     } else if (opt == 3) {
                         std::cout << "Nuevo tamaño de contexto: ";
                         std::cin >> context_size;
                     }
-                    matcher = ahocorasick::PatternMatcher(verbose, case_sensitive);
-                    if (!patterns.empty()) matcher.initialize(patterns);
                     break;
                 }
                 case 6: {
-                    if (matcher.patterns().empty() || text.empty()) {
+                    if (matcher.patterns().empty() || current_text().empty()) {
                         std::cout << "Error: Debe cargar patrones y texto primero.\n";
                         break;
                     }
-                    last_results = matcher.search(text, context_size);
+                    last_results = matcher.search(current_text(), context_size);
+                    last_stats = ahocorasick::MatchStats(matcher.patterns().size());
+                    for (const auto& r : last_results) {
+                        last_stats.add(r);
+                    }
                     std::cout << "Búsqueda completada. " << last_results.size()
                               << " coincidencias encontradas.\n";
                     break;
@@ -258,7 +434,7 @@ void interactive_menu() {
                         std::cout << "No hay resultados para generar resumen.\n";
                         break;
                     }
-                    generate_summary(last_results, matcher.patterns());
+                    generate_summary(last_stats, matcher.patterns());
                     break;
                 }
                 case 9: {
@@ -269,7 +445,7 @@ void interactive_menu() {
                     std::cout << "Ingrese la ruta de salida para el HTML: ";
                     std::string path;
                     std::getline(std::cin, path);
-                    export_to_html(last_results, matcher.patterns(), path);
+                    export_to_html(last_results, last_stats, matcher.patterns(), path);
                     break;
                 }
                 case 0: {
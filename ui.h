@@ -1,21 +1,40 @@
 #ifndef UI_H
 #define UI_H
 
+#include "InputSource.h"
+#include "MatchStats.h"
 #include "PatternMatcher.h"
+#include "ResultWriter.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ui {
 
 void generate_summary(const std::vector<ahocorasick::MatchResult>& results,
-                      const std::vector<std::string>& patterns);
+                      const ahocorasick::PatternPool& patterns);
+void generate_summary(const ahocorasick::MatchStats& stats,
+                      const ahocorasick::PatternPool& patterns);
 void display_results(const std::vector<ahocorasick::MatchResult>& results,
                      bool show_context = true);
 void export_to_html(const std::vector<ahocorasick::MatchResult>& results,
-                    const std::vector<std::string>& patterns,
+                    const ahocorasick::PatternPool& patterns,
+                    const std::string& output_path);
+void export_to_html(const std::vector<ahocorasick::MatchResult>& results,
+                    const ahocorasick::MatchStats& stats,
+                    const ahocorasick::PatternPool& patterns,
                     const std::string& output_path);
 std::vector<std::string> load_patterns_from_file(const std::string& file_path);
 std::string load_text_from_file(const std::string& file_path);
+// Escanea la entrada por bloques de tamaño fijo, conservando el estado del
+// autómata entre bloques, y entrega cada coincidencia a un ResultWriter
+// (texto, HTML...) en cuanto se encuentra.
+size_t scan_stream(ahocorasick::BlockSource& reader,
+                   const ahocorasick::PatternMatcher& matcher,
+                   size_t context_size, std::string_view document,
+                   ahocorasick::ResultWriter& writer);
+// Modo no interactivo: proyecto -p patrones.txt [opciones] [archivo...]
+int run_command_line(int argc, char* argv[]);
 void interactive_menu();
 
 } // namespace ui